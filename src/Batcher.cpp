@@ -0,0 +1,320 @@
+#include "Batcher.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace tempdb {
+
+    RespProtocol::Response Batcher::Completion::wait(Deadline deadline) {
+        if (deadline_ < deadline) {
+            deadline = deadline_;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto isDone = [this] { return done_.load(std::memory_order_acquire); };
+
+        if (deadline == kNoDeadline) {
+            completed_.wait(lock, isDone);
+        } else if (!completed_.wait_until(lock, deadline, isDone)) {
+            // The reply may still arrive, the I/O thread completes this slot unobserved
+            throw TimeoutError("Request timed out waiting for the reply");
+        }
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return std::move(*response_);
+    }
+
+    void Batcher::Completion::complete(RespProtocol::Response&& response) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            response_.emplace(std::move(response));
+            completedAt_ = std::chrono::steady_clock::now();
+            done_.store(true, std::memory_order_release);
+        }
+        completed_.notify_all();
+    }
+
+    void Batcher::Completion::fail(std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = error;
+            done_.store(true, std::memory_order_release);
+        }
+        completed_.notify_all();
+    }
+
+    Batcher::Batcher(Network& network, const BatchOptions& options)
+        : network_(network), options_(options), depth_(options.pipeline),
+          inFlightGauge_(Metrics::instance().gauge("tempdb_inflight_requests",
+                                                    "Pipelined requests awaiting a reply")),
+          depthGauge_(Metrics::instance().gauge("tempdb_pipeline_depth",
+                                                "Adaptive limit on pipelined requests, summed over connections")) {
+
+        size_t capacity = 1;
+        while (capacity < options_.queueCapacity) {
+            capacity <<= 1;
+        }
+        ring_ = std::make_unique<Cell[]>(capacity);
+        mask_ = capacity - 1;
+        for (size_t i = 0; i < capacity; ++i) {
+            ring_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd_ < 0) {
+            throw std::runtime_error("Error: Failed to create batcher wakeup descriptor");
+        }
+
+        reportedDepth_ = depth_.depth();
+        depthGauge_.add(static_cast<int64_t>(reportedDepth_));
+
+        io_ = std::thread(&Batcher::ioLoop, this);
+    }
+
+    Batcher::~Batcher() {
+        stopping_.store(true);
+        wake();
+        io_.join();
+        close(wakeFd_);
+        depthGauge_.sub(static_cast<int64_t>(reportedDepth_));
+    }
+
+    std::shared_ptr<Batcher::Completion> Batcher::submit(std::string command, Deadline deadline) {
+        auto completion = std::make_shared<Completion>();
+        completion->deadline_ = deadline;
+
+        if (failed_.load(std::memory_order_acquire)) {
+            completion->fail(error_);
+            return completion;
+        }
+
+        // Bounded MPMC ring (Vyukov): a cell is free for position p once its sequence equals p
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &ring_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Ring full, let the I/O thread catch up
+                std::this_thread::yield();
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->command = std::move(command);
+        cell->completion = completion;
+        cell->sequence.store(pos + 1);
+
+        // Only pay for the wakeup syscall when the I/O thread is actually asleep
+        if (sleeping_.load() && sleeping_.exchange(false)) {
+            wake();
+        }
+        return completion;
+    }
+
+    bool Batcher::pop(std::string& command, std::shared_ptr<Completion>& completion) {
+        Cell& cell = ring_[dequeuePos_ & mask_];
+        if (cell.sequence.load() != dequeuePos_ + 1) {
+            return false;
+        }
+
+        command = std::move(cell.command);
+        completion = std::move(cell.completion);
+        cell.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+
+    void Batcher::ioLoop() {
+        while (true) {
+            drainQueue();
+
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    auto now = std::chrono::steady_clock::now();
+                    if (flushEnd_ < outgoing_.size() &&
+                        (outgoing_.size() - flushEnd_ >= options_.maxBatchBytes ||
+                         now >= firstQueuedAt_ + options_.window || stopping_.load())) {
+                        flushEnd_ = outgoing_.size();
+                    }
+
+                    if (written_ < flushEnd_) {
+                        written_ += network_.sendAvailable(outgoing_.data() + written_, flushEnd_ - written_);
+                        markSent();
+                    }
+                    if (written_ == outgoing_.size()) {
+                        outgoing_.clear();
+                        written_ = 0;
+                        flushEnd_ = 0;
+                    }
+
+                    completeReplies();
+                } catch (const std::runtime_error&) {
+                    failAll(std::current_exception());
+                }
+            }
+
+            // When stopping, requests past their deadline are not worth waiting for: nobody
+            // observes their replies and the connection is not reused
+            Deadline stopAt = kNoDeadline;
+            if (stopping_.load() && !canDrain()) {
+                if (failed_.load(std::memory_order_relaxed) || inFlight_.empty()) {
+                    break;
+                }
+                stopAt = lastDeadline();
+                if (stopAt <= std::chrono::steady_clock::now()) {
+                    break;
+                }
+            }
+
+            pollfd fds[2] = {{wakeFd_, POLLIN, 0}, {network_.fd(), 0, 0}};
+            if (!failed_.load(std::memory_order_relaxed)) {
+                if (!inFlight_.empty()) {
+                    fds[1].events |= POLLIN;
+                }
+                if (written_ < flushEnd_) {
+                    fds[1].events |= POLLOUT;
+                }
+            }
+
+            timespec timeout = {0, 0};
+            timespec* timeoutPtr = nullptr;
+            if (flushEnd_ < outgoing_.size() || stopAt != kNoDeadline) {
+                // Sleep no longer than the rest of the batching window, or than the replies are wanted
+                auto wakeAt = flushEnd_ < outgoing_.size() ? std::min(firstQueuedAt_ + options_.window, stopAt) : stopAt;
+                auto remaining = wakeAt - std::chrono::steady_clock::now();
+                auto nanos = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count());
+                timeout.tv_sec = static_cast<time_t>(nanos / 1000000000);
+                timeout.tv_nsec = static_cast<long>(nanos % 1000000000);
+                timeoutPtr = &timeout;
+            }
+
+            // Announce the sleep before the last look at the ring, so a concurrent submit either
+            // is seen here or sees the flag and wakes us. At full depth only a reply can make room.
+            sleeping_.store(true);
+            if (canDrain()) {
+                timeoutPtr = &timeout;
+                timeout = {0, 0};
+            }
+
+            ppoll(fds, fds[1].events ? 2 : 1, timeoutPtr, nullptr);
+            sleeping_.store(false);
+
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                if (read(wakeFd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                    failAll(std::make_exception_ptr(std::runtime_error("Error: Batcher wakeup failed")));
+                }
+            }
+        }
+    }
+
+    bool Batcher::canDrain() const {
+        return (inFlight_.size() < depth_.depth() || failed_.load(std::memory_order_relaxed)) &&
+               ring_[dequeuePos_ & mask_].sequence.load() == dequeuePos_ + 1;
+    }
+
+    void Batcher::drainQueue() {
+        std::string command;
+        std::shared_ptr<Completion> completion;
+
+        // Failed submissions never enter inFlight_, so after a failure the whole ring is drained
+        while (inFlight_.size() < depth_.depth() && pop(command, completion)) {
+            if (failed_.load(std::memory_order_relaxed)) {
+                completion->fail(error_);
+                continue;
+            }
+            if (completion->deadline_ != kNoDeadline && completion->deadline_ <= std::chrono::steady_clock::now()) {
+                // Nobody is waiting for it any more, so never send it
+                completion->fail(std::make_exception_ptr(TimeoutError("Request timed out before it was sent")));
+                continue;
+            }
+
+            if (outgoing_.size() == flushEnd_) {
+                firstQueuedAt_ = std::chrono::steady_clock::now();
+            }
+            outgoing_ += command;
+            inFlight_.push_back(InFlight{std::move(completion), outgoing_.size(), {}});
+            inFlightGauge_.add();
+        }
+
+        depth_.onSend(inFlight_.size());
+    }
+
+    void Batcher::markSent() {
+        auto now = std::chrono::steady_clock::now();
+        while (unsent_ < inFlight_.size() && inFlight_[unsent_].end <= written_) {
+            inFlight_[unsent_++].sentAt = now;
+        }
+    }
+
+    void Batcher::completeReplies() {
+        std::string reply;
+        while (!inFlight_.empty() && network_.tryReceiveReply(reply)) {
+            auto now = std::chrono::steady_clock::now();
+            InFlight request = std::move(inFlight_.front());
+            inFlight_.pop_front();
+            if (unsent_ > 0) {
+                --unsent_;
+            }
+            inFlightGauge_.sub();
+            depth_.onReply(now - request.sentAt, now);
+            request.completion->complete(RespProtocol::parseResponse(reply));
+        }
+
+        size_t depth = depth_.depth();
+        if (depth != reportedDepth_) {
+            depthGauge_.add(static_cast<int64_t>(depth) - static_cast<int64_t>(reportedDepth_));
+            reportedDepth_ = depth;
+        }
+    }
+
+    Deadline Batcher::lastDeadline() const {
+        Deadline last = Deadline::min();
+        for (const auto& request : inFlight_) {
+            last = std::max(last, request.completion->deadline_);
+        }
+        return last;
+    }
+
+    void Batcher::failAll(std::exception_ptr error) {
+        error_ = error;
+        failed_.store(true, std::memory_order_release);
+
+        for (auto& request : inFlight_) {
+            request.completion->fail(error);
+        }
+        inFlightGauge_.sub(static_cast<int64_t>(inFlight_.size()));
+        inFlight_.clear();
+        unsent_ = 0;
+        outgoing_.clear();
+        written_ = 0;
+        flushEnd_ = 0;
+
+        // Anything still on the ring is failed by drainQueue()
+        drainQueue();
+    }
+
+    void Batcher::wake() {
+        uint64_t one = 1;
+        // A full counter still leaves the descriptor readable, so a failed write loses nothing
+        ssize_t result = write(wakeFd_, &one, sizeof(one));
+        (void)result;
+    }
+
+} // namespace tempdb
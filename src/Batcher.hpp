@@ -0,0 +1,208 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <optional>
+#include <exception>
+#include <condition_variable>
+
+#include "Metrics.hpp"
+#include "Network.hpp"
+#include "PipelineController.hpp"
+#include "RespProtocol.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Write coalescing limits for a Batcher
+    */
+    struct BatchOptions {
+        std::chrono::microseconds window{200};  ///< Longest time the first queued request waits for company
+        size_t maxBatchBytes = 64 * 1024;       ///< Flush as soon as this many bytes are queued
+        size_t queueCapacity = 4096;            ///< Submission ring slots, rounded up to a power of two
+        PipelineOptions pipeline;               ///< Limits of the adaptive in-flight depth
+    };
+
+    /**
+    * @brief Coalesces requests from many callers into pipelined writes on one connection
+    *
+    * Callers submit RESP-encoded commands from any thread into a lock-free
+    * multi-producer ring. A single I/O thread owns the socket: it drains the
+    * ring, gathers everything submitted within a short window (or until a byte
+    * threshold is reached) into one write, and parses replies as they arrive,
+    * completing each request's slot in submission order. Submitters never share
+    * a lock; each one only waits on its own slot.
+    *
+    * The number of requests handed to the connection and not yet answered is
+    * capped by a PipelineController, which adapts it to the measured RTT and
+    * throughput. Requests beyond the cap wait on the ring.
+    */
+    class Batcher {
+    public:
+        /**
+        * @brief Completion slot of one submitted request
+        */
+        class Completion {
+        public:
+            /**
+            * @brief Block until the reply arrives
+            * @param deadline Time to give up waiting, in addition to the one given to submit()
+            * @return Parsed reply
+            * @throws TimeoutError if a deadline passes first
+            * @throws std::runtime_error if the connection failed
+            */
+            RespProtocol::Response wait(Deadline deadline = kNoDeadline);
+
+            /**
+            * @brief Whether the reply (or an error) is available without blocking
+            */
+            bool ready() const { return done_.load(std::memory_order_acquire); }
+
+            /**
+            * @brief When the I/O thread parsed the reply, valid once wait() has returned it
+            */
+            std::chrono::steady_clock::time_point completedAt() const { return completedAt_; }
+
+        private:
+            friend class Batcher;
+
+            void complete(RespProtocol::Response&& response);
+            void fail(std::exception_ptr error);
+
+            Deadline deadline_ = kNoDeadline;                   ///< Deadline given to submit()
+            std::atomic<bool> done_{false};                     ///< Set once response_ or error_ is filled
+            std::mutex mutex_;                                  ///< Guards the members below, uncontended
+            std::condition_variable completed_;                 ///< Signalled when done_ is set
+            std::optional<RespProtocol::Response> response_;    ///< Reply, taken by wait()
+            std::chrono::steady_clock::time_point completedAt_; ///< Arrival of the reply
+            std::exception_ptr error_;                          ///< Connection or timeout error
+        };
+
+        /**
+        * @brief Constructor - starts the I/O thread
+        * @param network Connection to share, must outlive the batcher
+        * @param options Batching limits
+        * @throws std::runtime_error if the wakeup descriptor cannot be created
+        */
+        explicit Batcher(Network& network, const BatchOptions& options = BatchOptions());
+
+        /**
+        * @brief Destructor - flushes queued requests, waits for their replies and stops the I/O thread
+        *
+        * Replies are only waited for while some request is still within its deadline.
+        */
+        ~Batcher();
+
+        Batcher(const Batcher&) = delete;
+        Batcher& operator=(const Batcher&) = delete;
+
+        /**
+        * @brief Queue a command for the next batch
+        *
+        * Lock-free unless the ring is full, in which case the caller yields until
+        * the I/O thread makes room. A request whose deadline passes before it is
+        * written is never sent.
+        * @param command RESP-encoded command
+        * @param deadline Time by which the reply must arrive
+        * @return Slot completed with the parsed reply, or the connection error
+        */
+        std::shared_ptr<Completion> submit(std::string command, Deadline deadline = kNoDeadline);
+
+    private:
+        /**
+        * @brief One slot of the submission ring
+        */
+        struct Cell {
+            std::atomic<size_t> sequence{0};        ///< Ring position this cell is ready for
+            std::string command;                    ///< RESP-encoded command
+            std::shared_ptr<Completion> completion; ///< Completed by the I/O thread
+        };
+
+        /**
+        * @brief Request handed to the connection, awaiting its reply
+        */
+        struct InFlight {
+            std::shared_ptr<Completion> completion;     ///< Completed with the reply
+            size_t end;                                 ///< Offset in outgoing_ just past the request
+            std::chrono::steady_clock::time_point sentAt; ///< When its last byte was written
+        };
+
+        /**
+        * @brief Take the oldest submission off the ring (I/O thread only)
+        * @return false if the ring is empty
+        */
+        bool pop(std::string& command, std::shared_ptr<Completion>& completion);
+
+        void ioLoop();
+
+        /**
+        * @brief Move submissions from the ring into the outgoing buffer, up to the pipeline depth
+        */
+        void drainQueue();
+
+        /**
+        * @brief Stamp the requests whose last byte has now been written
+        */
+        void markSent();
+
+        /**
+        * @brief Whether a submission is waiting on the ring and the depth leaves room for it
+        */
+        bool canDrain() const;
+
+        /**
+        * @brief Complete in-flight requests from every reply received so far
+        */
+        void completeReplies();
+
+        /**
+        * @brief Latest deadline of the requests in flight, which bounds how long stopping waits for replies
+        */
+        Deadline lastDeadline() const;
+
+        /**
+        * @brief Fail every in-flight and queued request after a connection error
+        * @param error Error handed to the submitters
+        */
+        void failAll(std::exception_ptr error);
+
+        /**
+        * @brief Interrupt the I/O thread's poll
+        */
+        void wake();
+
+        Network& network_;                              ///< Shared connection
+        BatchOptions options_;                          ///< Batching limits
+
+        std::unique_ptr<Cell[]> ring_;                  ///< Submission ring
+        size_t mask_;                                   ///< Ring size minus one
+        std::atomic<size_t> enqueuePos_{0};             ///< Next position producers claim
+        size_t dequeuePos_ = 0;                         ///< Next position the I/O thread reads
+
+        int wakeFd_;                                    ///< eventfd the I/O thread polls alongside the socket
+        std::atomic<bool> sleeping_{false};             ///< I/O thread is (about to be) blocked in poll
+        std::atomic<bool> stopping_{false};             ///< Set by the destructor
+        std::atomic<bool> failed_{false};               ///< Set once error_ is filled
+        std::exception_ptr error_;                      ///< Connection error, fails new submissions
+
+        // Owned by the I/O thread
+        std::string outgoing_;                          ///< Coalesced requests not yet fully written
+        size_t written_ = 0;                            ///< Bytes of outgoing_ already written
+        size_t flushEnd_ = 0;                           ///< End of the batch being flushed, the rest is still gathering
+        std::chrono::steady_clock::time_point firstQueuedAt_; ///< When the current batch started
+        std::deque<InFlight> inFlight_;                 ///< Queued or written, awaiting reply
+        size_t unsent_ = 0;                             ///< Index of the first inFlight_ entry not fully written
+        PipelineController depth_;                      ///< Limit on inFlight_
+        size_t reportedDepth_ = 0;                      ///< Depth last added to depthGauge_
+        Metrics::Gauge& inFlightGauge_;                 ///< Exported size of inFlight_, across batchers
+        Metrics::Gauge& depthGauge_;                    ///< Exported pipeline depth, summed across batchers
+
+        std::thread io_;                                ///< Runs ioLoop
+    };
+
+} // namespace tempdb
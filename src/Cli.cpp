@@ -1,4 +1,6 @@
 #include "Cli.hpp"
+#include "Network.hpp"
+
 #include <string>
 #include <sstream>
 #include <stdexcept>
@@ -9,35 +11,149 @@ namespace tempdb {
 Cli::ParseResult Cli::parseArguments(int argc, char* argv[]) {
     
     std::stringstream ss;
-    ss << "Usage: " << argv[0] << " -h <host-ip> -p <port>" << '\n';
-    ss << "OR: " << argv[0] << " -host <host-ip> -port <port>" << '\n';
+    ss << "Usage: " << argv[0] << " -h <host-ip> -p <port> [options]" << '\n';
+    ss << "OR: " << argv[0] << " -host <host-ip> -port <port> [options]" << '\n';
+    ss << "OR: " << argv[0] << " --servers <host:port,...> --exec <command> [options]" << '\n';
 
-    if (argc != 5) {
+    if (argc < 5) {
         return ParseResult(false, "", 0, ss.str());
     }
 
-    std::string hostFlag = argv[1];
-    std::string hostValue = argv[2];
-    std::string portFlag = argv[3];
-    std::string portValue = argv[4];
+    ParseResult result(true);
+    std::string hostValue;
+    std::string portValue;
 
-    // Check for valid host flags
-    if (hostFlag != "-h" && hostFlag != "-host") {
-        ss << "Error: Invalid host flag '" << hostFlag << "'. Expected -h or -host.";
-        return ParseResult(false, "", 0, ss.str());
-    }
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            std::string flag = argv[i];
 
-    // Check for valid port flags
-    if (portFlag != "-p" && portFlag != "-port") {
-        ss << "Error: Invalid port flag '" << portFlag << "'. Expected -p or -port.";
-        return ParseResult(false, "", 0, ss.str());
-    }
+            // The only flag without a value
+            if (flag == "-v" || flag == "--verbose") {
+                result.verbose = true;
+                --i;
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                ss << "Error: Missing value for flag '" << flag << "'.";
+                return ParseResult(false, "", 0, ss.str());
+            }
+            std::string value = argv[i + 1];
+
+            if (flag == "-h" || flag == "-host") {
+                hostValue = value;
+            } else if (flag == "-p" || flag == "-port") {
+                portValue = value;
+            } else if (flag == "--record") {
+                result.recordPath = value;
+            } else if (flag == "--replay") {
+                result.replayPath = value;
+            } else if (flag == "--speed") {
+                result.replaySpeed = validateSpeed(value);
+            } else if (flag == "--profile") {
+                ConnectionProfile::fromName(value);
+                result.profile = value;
+            } else if (flag == "--load") {
+                result.loadRate = validatePositive("Load rate", value);
+            } else if (flag == "--duration") {
+                result.loadDuration = validatePositive("Duration", value);
+            } else if (flag == "--arrivals") {
+                if (value != "constant" && value != "poisson") {
+                    throw std::invalid_argument("Arrivals must be 'constant' or 'poisson'");
+                }
+                result.poissonArrivals = value == "poisson";
+            } else if (flag == "--command") {
+                result.loadCommand = value;
+            } else if (flag == "--hdr-out") {
+                result.histogramPath = value;
+            } else if (flag == "--compress") {
+                result.compressThreshold = validateCount("Compression threshold", value);
+            } else if (flag == "--compress-dict") {
+                result.compressDictionary = value;
+            } else if (flag == "--replica") {
+                validateAddress(value, result.replicaHost, result.replicaPort);
+            } else if (flag == "--hedge-percentile") {
+                result.hedgePercentile = validatePositive("Hedge percentile", value);
+                if (result.hedgePercentile >= 100) {
+                    throw std::invalid_argument("Hedge percentile must be below 100");
+                }
+            } else if (flag == "--timeout") {
+                result.timeoutMillis = validateCount("Timeout", value);
+            } else if (flag == "--servers") {
+                result.servers = validateAddressList(value);
+            } else if (flag == "--exec") {
+                result.execCommand = value;
+            } else if (flag == "--metrics-file") {
+                result.metricsPath = value;
+            } else if (flag == "--trace") {
+                result.tracePath = value;
+            } else if (flag == "--prefetch") {
+                result.prefetchPath = value;
+            } else if (flag == "--connections") {
+                result.connections = validateCount("Connection count", value);
+            } else {
+                ss << "Error: Unknown flag '" << flag << "'.";
+                return ParseResult(false, "", 0, ss.str());
+            }
+        }
+
+        int modes = !result.recordPath.empty() + !result.replayPath.empty() + (result.loadRate > 0) +
+                    !result.servers.empty();
+        if (modes > 1) {
+            ss << "Error: --record, --replay, --load and --servers cannot be used together.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+
+        bool interactive = result.replayPath.empty() && result.loadRate == 0 && result.servers.empty();
+        if (!result.tracePath.empty() && !interactive) {
+            ss << "Error: --trace only applies to an interactive session.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+        if (!result.prefetchPath.empty() && !interactive) {
+            ss << "Error: --prefetch only applies to an interactive session.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+        if (!result.replicaHost.empty() && !interactive) {
+            ss << "Error: --replica only applies to an interactive session.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+
+        if (result.servers.empty() != result.execCommand.empty()) {
+            ss << "Error: --servers and --exec must be used together.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+
+        // Fan-out takes its servers from --servers instead of -h/-p
+        if (!result.servers.empty()) {
+            if (!hostValue.empty() || !portValue.empty()) {
+                ss << "Error: --servers cannot be combined with -h/-p.";
+                return ParseResult(false, "", 0, ss.str());
+            }
+            return result;
+        }
+
+        // Check for valid host flags
+        if (hostValue.empty()) {
+            ss << "Error: Missing host flag. Expected -h or -host.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+
+        // Check for valid port flags
+        if (portValue.empty()) {
+            ss << "Error: Missing port flag. Expected -p or -port.";
+            return ParseResult(false, "", 0, ss.str());
+        }
+
+        if (!result.compressDictionary.empty() && result.compressThreshold == 0) {
+            ss << "Error: --compress-dict requires --compress.";
+            return ParseResult(false, "", 0, ss.str());
+        }
 
-    try {
         validateHost(hostValue);
-        int port = validatePort(portValue);
+        result.host = hostValue;
+        result.port = validatePort(portValue);
 
-        return ParseResult(true, hostValue, port);
+        return result;
     } catch (const std::invalid_argument& e) {
         return ParseResult(false, "", 0, e.what());
     }
@@ -88,17 +204,131 @@ void Cli::validateHost(const std::string& host) {
     
 }
 
+double Cli::validateSpeed(const std::string& speedString) {
+
+    if (speedString == "max") {
+        return 0;
+    }
+
+    std::string number = speedString;
+    if (!number.empty() && number.back() == 'x') {
+        number.pop_back();
+    }
+
+    try {
+        return validatePositive("Replay speed", number);
+    } catch (const std::invalid_argument&) {
+        throw std::invalid_argument("Replay speed must be a positive multiplier (e.g. 1x, 2.5x) or 'max'");
+    }
+}
+
+double Cli::validatePositive(const std::string& name, const std::string& numberString) {
+
+    size_t parsed = 0;
+    double number = 0;
+    try {
+        number = std::stod(numberString, &parsed);
+    } catch (const std::exception&) {
+        parsed = 0;
+    }
+
+    if (numberString.empty() || parsed != numberString.size() || !(number > 0)) {
+        throw std::invalid_argument(name + " must be a positive number");
+    }
+
+    return number;
+}
+
+int Cli::validateCount(const std::string& name, const std::string& countString) {
+
+    if (countString.empty() || countString.size() > 6) {
+        throw std::invalid_argument(name + " must be between 1 and 999999");
+    }
+
+    for (char c : countString) {
+        if (!std::isdigit(c)) {
+            throw std::invalid_argument(name + " must contain only digits");
+        }
+    }
+
+    int count = std::stoi(countString);
+    if (count <= 0) {
+        throw std::invalid_argument(name + " must be between 1 and 999999");
+    }
+
+    return count;
+}
+
+void Cli::validateAddress(const std::string& address, std::string& host, int& port) {
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("Address '" + address + "' must be of the form <host>:<port>");
+    }
+
+    host = address.substr(0, colon);
+    validateHost(host);
+    port = validatePort(address.substr(colon + 1));
+}
+
+std::vector<std::pair<std::string, int>> Cli::validateAddressList(const std::string& list) {
+
+    std::vector<std::pair<std::string, int>> addresses;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+
+        std::string host;
+        int port = 0;
+        validateAddress(list.substr(start, comma - start), host, port);
+        addresses.emplace_back(host, port);
+        start = comma + 1;
+    }
+
+    return addresses;
+}
+
 void Cli::displayUsage(const std::string& programName) {
-    std::cout << "Usage: " << programName << " -h <host-ip> -p <port>" << std::endl;
-    std::cout << "   OR: " << programName << " -host <host-ip> -port <port>" << std::endl;
+    std::cout << "Usage: " << programName << " -h <host-ip> -p <port> [options]" << std::endl;
+    std::cout << "   OR: " << programName << " -host <host-ip> -port <port> [options]" << std::endl;
+    std::cout << "   OR: " << programName << " --servers <host:port,...> --exec <command> [options]" << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -h, -host <host>    Server hostname or IP address" << std::endl;
     std::cout << "  -p, -port <port>    Server port number (1-65535)" << std::endl;
+    std::cout << "  -v, --verbose       Print connection diagnostics at startup" << std::endl;
+    std::cout << "  --profile <name>    Socket tuning: low-latency, throughput or default" << std::endl;
+    std::cout << "  --compress <bytes>  Compress values of at least <bytes> bytes (LZ4)" << std::endl;
+    std::cout << "  --compress-dict <file> Shared dictionary for --compress" << std::endl;
+    std::cout << "  --replica <host:port> Hedge read-only commands to this replica (interactive only)" << std::endl;
+    std::cout << "  --hedge-percentile <P> Hedge a read once it runs past this latency percentile (default 95)" << std::endl;
+    std::cout << "  --timeout <ms>      Fail any connect or request not done within <ms> milliseconds" << std::endl;
+    std::cout << "  --record <file>     Record issued commands into a traffic log" << std::endl;
+    std::cout << "  --replay <file>     Replay a traffic log instead of starting a session" << std::endl;
+    std::cout << "  --speed <N>x|max    Replay speed multiplier (default 1x)" << std::endl;
+    std::cout << "  --load <rate>       Run an open-loop load at <rate> requests/s instead of a session" << std::endl;
+    std::cout << "  --duration <sec>    Open-loop load duration (default 10)" << std::endl;
+    std::cout << "  --arrivals <type>   Open-loop arrivals: constant or poisson (default constant)" << std::endl;
+    std::cout << "  --command <cmd>     Command issued by the open-loop load (default PING)" << std::endl;
+    std::cout << "  --servers <list>    Comma-separated host:port nodes to fan a command out to (name lookups ignore --timeout)" << std::endl;
+    std::cout << "  --exec <command>    Command run on every --servers node (per-node --timeout, default 5000)" << std::endl;
+    std::cout << "  --metrics-file <file> Write client metrics in Prometheus text format on exit" << std::endl;
+    std::cout << "  --prefetch <file>   GET the keys listed in <file> before the session and serve them from a cache" << std::endl;
+    std::cout << "  --trace <file>      Write per-request spans as Chrome trace JSON on exit (interactive only)" << std::endl;
+    std::cout << "  --connections <N>   Number of parallel replay/load connections (default 1)" << std::endl;
+    std::cout << "  --hdr-out <file>    Export the replay/load latency histogram (us)" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << programName << " -h localhost -p 6379" << std::endl;
     std::cout << "  " << programName << " -host 127.0.0.1 -port 9000" << std::endl;
+    std::cout << "  " << programName << " -h localhost -p 6379 --profile low-latency" << std::endl;
+    std::cout << "  " << programName << " -h localhost -p 6379 --record session.tlog" << std::endl;
+    std::cout << "  " << programName << " -h localhost -p 6379 --replay session.tlog --speed 4x --connections 8" << std::endl;
+    std::cout << "  " << programName << " --servers 10.0.0.1:6379,10.0.0.2:6379 --exec \"INFO\" --timeout 500" << std::endl;
+    std::cout << "  " << programName << " -h localhost -p 6379 --load 20000 --arrivals poisson --command \"GET key\" --hdr-out get.hgrm" << std::endl;
 }
 
 } // namespace tempdb
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <utility>
 
 namespace tempdb {
 
@@ -19,6 +21,28 @@ namespace tempdb {
             std::string host;
             int port;
             std::string errorMessage;
+            std::string recordPath;         ///< Traffic log to record into, empty if disabled
+            std::string replayPath;         ///< Traffic log to replay, empty for interactive mode
+            double replaySpeed = 1.0;       ///< Replay speed multiplier, 0 for max speed
+            int connections = 1;            ///< Number of parallel connections
+            std::string profile = "default"; ///< Socket tuning profile name
+            double loadRate = 0;            ///< Open-loop target requests/s, 0 when not load testing
+            double loadDuration = 10;       ///< Open-loop run length in seconds
+            bool poissonArrivals = false;   ///< Open-loop exponential inter-arrival times
+            std::string loadCommand = "PING"; ///< Command issued by the open-loop load
+            std::string histogramPath;      ///< Latency histogram export file, empty to skip
+            int compressThreshold = 0;      ///< Compress values of at least this many bytes, 0 to disable
+            std::string compressDictionary; ///< Shared compression dictionary file, empty for none
+            std::string replicaHost;        ///< Replica for hedged reads, empty to disable
+            int replicaPort = 0;            ///< Replica port
+            double hedgePercentile = 95;    ///< Hedge reads after this latency percentile
+            int timeoutMillis = 0;          ///< Per-request timeout in milliseconds, 0 for none
+            std::vector<std::pair<std::string, int>> servers; ///< Fan-out nodes, empty for a single server
+            std::string execCommand;        ///< Command run on every fan-out node
+            std::string metricsPath;        ///< Prometheus metrics file written on exit, empty to skip
+            std::string tracePath;          ///< Chrome trace file of per-request spans written on exit, empty to skip
+            std::string prefetchPath;       ///< Hot keys fetched before the session starts, empty to skip
+            bool verbose = false;           ///< Print connection diagnostics at startup
 
             ParseResult(bool s, const std::string& h = "", int p = 0, const std::string& err = "")
                 : success(s), host(h), port(p), errorMessage(err) {}
@@ -53,6 +77,49 @@ namespace tempdb {
         * @throws std::invalid_argument if host is invalid
         */
         static void validateHost(const std::string& host);
+
+        /**
+        * @brief Validate replay speed
+        * @param speedString Speed as "max", "<N>" or "<N>x"
+        * @return Speed multiplier, 0 for max speed
+        * @throws std::invalid_argument if speed is invalid
+        */
+        static double validateSpeed(const std::string& speedString);
+
+        /**
+        * @brief Validate a positive number
+        * @param name Option name used in error messages
+        * @param numberString Number as string
+        * @return Validated number
+        * @throws std::invalid_argument if the number is not positive
+        */
+        static double validatePositive(const std::string& name, const std::string& numberString);
+
+        /**
+        * @brief Validate a positive count
+        * @param name Option name used in error messages
+        * @param countString Count as string
+        * @return Validated count
+        * @throws std::invalid_argument if count is invalid
+        */
+        static int validateCount(const std::string& name, const std::string& countString);
+
+        /**
+        * @brief Validate a host:port pair
+        * @param address Address as "<host>:<port>"
+        * @param host Validated host
+        * @param port Validated port
+        * @throws std::invalid_argument if the address is invalid
+        */
+        static void validateAddress(const std::string& address, std::string& host, int& port);
+
+        /**
+        * @brief Validate a comma-separated list of host:port pairs
+        * @param list Addresses as "<host>:<port>,<host>:<port>,..."
+        * @return Validated host and port of every entry
+        * @throws std::invalid_argument if the list or any address is invalid
+        */
+        static std::vector<std::pair<std::string, int>> validateAddressList(const std::string& list);
     };
 
 } // namespace tempdb
\ No newline at end of file
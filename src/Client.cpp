@@ -1,14 +1,123 @@
 #include "Client.hpp"
+#include "Metrics.hpp"
 
 
+#include <algorithm>
+#include <cctype>
+#include <fstream>
 #include <iostream>
 #include <ostream>
 
 
 namespace tempdb {
 
-    Client::Client(const std::string& host, int port)
-        : network_(std::make_unique<Network>(host, port)), host_(host), port_(port), connected_(true) {
+    namespace {
+
+        // Prefetched values can go stale through other clients, so they are only trusted briefly
+        const std::chrono::seconds kPrefetchTtl(10);
+
+    } // namespace
+
+    Client::Client(const std::string& host, int port, const ConnectionProfile& profile, const std::string& recordPath)
+        : Client(std::make_unique<Network>(host, port, profile), host, port, recordPath) {}
+
+    Client::Client(std::unique_ptr<Network> network, const std::string& host, int port, const std::string& recordPath)
+        : network_(std::move(network)), host_(host), port_(port), connected_(true),
+          replyErrors_(Metrics::instance().counter("tempdb_errors_total", "Failed requests and connections, by error type",
+                                                   Metrics::label("type", "reply"))),
+          cacheHits_(Metrics::instance().counter("tempdb_cache_hits_total", "GETs answered from prefetched keys")),
+          tracing_(Tracer::instance().enabled()) {
+
+        if (tracing_) {
+            network_->enableTimestamps();
+        }
+
+        if (!recordPath.empty()) {
+            recorder_ = std::make_unique<TrafficLog::Writer>(recordPath);
+        }
+    }
+
+    void Client::enableCompression(const CodecOptions& options) {
+        codec_ = std::make_unique<Codec>(options);
+    }
+
+    void Client::enableHedging(const std::string& host, int port, const ConnectionProfile& profile, double percentile) {
+        enableHedging(std::make_unique<Network>(host, port, profile), percentile);
+    }
+
+    void Client::enableHedging(std::unique_ptr<Network> replica, double percentile) {
+        replica_ = std::move(replica);
+        hedger_ = std::make_unique<Hedger>(*network_, *replica_, percentile);
+    }
+
+    void Client::setTimeout(std::chrono::milliseconds timeout) {
+        timeout_ = timeout;
+    }
+
+    size_t Client::prefetch(const std::vector<std::string>& keys) {
+        if (keys.empty()) {
+            return 0;
+        }
+
+        std::string batch;
+        for (const auto& key : keys) {
+            batch += protocol_.encodeArray({"GET", key});
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        Deadline deadline = timeout_.count() > 0 ? now + timeout_ : kNoDeadline;
+        size_t received = 0;
+        size_t owed = 0;
+        bool sent = false;
+
+        try {
+            // A batch cut short still goes out in full ahead of the next command, so its
+            // replies are owed below, all of them, rather than the one sendData() would skip
+            network_->sendData(batch, deadline, false);
+            sent = true;
+            for (; received < keys.size(); ++received) {
+                network_->receiveReply(reply_, deadline);
+                // Misses ("$-1") and errors are left to the server
+                if (reply_.compare(0, 3, "$-1") != 0 && reply_[0] == '$') {
+                    cache_[keys[received]] = CachedReply{reply_, now + kPrefetchTtl};
+                }
+            }
+        } catch (const PartialSendError& e) {
+            owed = keys.size();
+            std::cerr << "Warning: Prefetch not sent in time: " << e.what() << std::endl;
+        } catch (const TimeoutError& e) {
+            // Nothing is owed for a batch that never went out. Once it did, receiveReply()
+            // skips the reply it gave up on and the rest are owed too
+            if (sent) {
+                owed = keys.size() - received - 1;
+            }
+            std::cerr << "Warning: Prefetch stopped after " << received << "/" << keys.size() << " keys: "
+                      << e.what() << std::endl;
+        }
+
+        for (size_t i = 0; i < owed; ++i) {
+            network_->discardNextReply();
+        }
+
+        return cache_.size();
+    }
+
+    std::vector<std::string> Client::loadKeys(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("Error: Could not open key list: " + path);
+        }
+
+        std::vector<std::string> keys;
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos) {
+                continue;
+            }
+            keys.push_back(line.substr(start, line.find_last_not_of(" \t\r") + 1 - start));
+        }
+        return keys;
     }
 
     int Client::run() {
@@ -46,37 +155,140 @@ namespace tempdb {
             return false;
         }
 
-        //std::cout << input<<std::endl;
+        if (tracing_) {
+            span_ = Tracer::Span();
+            span_.start = std::chrono::steady_clock::now();
+        }
 
-                        // Convert input to RESP format
-        auto tokens = protocol_.splitInput(input);
-        if (tokens.empty()) {
+        // Token, request and reply buffers are members and are reused from command to command
+        protocol_.splitInput(input, tokens_, responsePool_);
+        if (tokens_.empty()) {
             return true;
         }
 
-        // UserInut - Splitted
-        // for (const auto& str : tokens) {
-        //     std::cout << str << "_";
-        // }
-        // std::cout<<"\n";
+        commandName_.assign(tokens_[0]);
+        std::transform(commandName_.begin(), commandName_.end(), commandName_.begin(),
+                       [](unsigned char c) { return std::toupper(c); });
+
+        if (codec_) {
+            codec_->encodeCommand(tokens_);
+        }
 
         //RESP Encoding
-        std::string respCommand = protocol_.encodeArray(tokens);
-        if (!sendCommand(respCommand)) {
-            return false;
+        protocol_.encodeArray(tokens_, request_);
+        if (recorder_) {
+            // Recorded even when the cache answers, so a replay sends what the session asked for
+            recorder_->append(request_);
         }
 
-        if (!receiveResponse()) {
-            return false;
+        if (!cache_.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            if (serveFromCache()) {
+                recordRequest(start);
+                if (tracing_) {
+                    traceRequest(false);
+                }
+                return true;
+            }
+        }
+
+        Deadline deadline = kNoDeadline;
+        if (timeout_.count() > 0) {
+            deadline = std::chrono::steady_clock::now() + timeout_;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        span_.enqueued = start;
+        bool keepGoing;
+        bool hedged = hedger_ && Hedger::isReadOnly(commandName_);
+
+        if (hedged) {
+            keepGoing = executeHedged(commandName_, request_, deadline);
+        } else if (!sendCommand(request_, deadline)) {
+            // A send that timed out leaves the session usable
+            keepGoing = connected_;
+        } else {
+            keepGoing = receiveResponse(deadline);
+        }
+
+        recordRequest(start);
+        if (tracing_) {
+            traceRequest(!hedged);
         }
+        return keepGoing;
+    }
+
+    void Client::traceRequest(bool wire) {
+        span_.end = std::chrono::steady_clock::now();
+        span_.name = commandName_;
 
-        return true;
+        const WireTimes& times = network_->wireTimes();
+        if (wire) {
+            span_.firstByteWritten = times.firstByteWritten;
+        }
+        // Reply timestamps are those of the last reply read, which is this one only if it completed
+        if (wire && span_.replyComplete != Tracer::TimePoint()) {
+            span_.firstReplyByte = times.firstReplyByte;
+            span_.kernelReceived = times.kernelReceived;
+        }
+
+        Tracer::instance().record(std::move(span_));
     }
 
-    bool Client::sendCommand(const std::string& command) {
+    bool Client::serveFromCache() {
+        if (commandName_ == "GET" && tokens_.size() == 2) {
+            auto it = cache_.find(tokens_[1]);
+            if (it == cache_.end()) {
+                return false;
+            }
+            if (std::chrono::steady_clock::now() >= it->second.expires) {
+                cache_.erase(it);
+                return false;
+            }
+
+            if (tracing_) {
+                span_.replyComplete = std::chrono::steady_clock::now();
+            }
+            cacheHits_.add();
+            displayResponse(it->second.reply);
+            return true;
+        }
+
+        // Anything else naming a cached key may change it
+        if (commandName_.compare(0, 5, "FLUSH") == 0) {
+            cache_.clear();
+        }
+        for (size_t i = 1; i < tokens_.size() && !cache_.empty(); ++i) {
+            cache_.erase(tokens_[i]);
+        }
+        return false;
+    }
+
+    void Client::recordRequest(std::chrono::steady_clock::time_point start) {
+        // The registry lookup builds label strings, so it only runs the first time a command is seen
+        auto it = commandMetrics_.find(commandName_);
+        if (it == commandMetrics_.end()) {
+            std::string labels = Metrics::label("command", commandName_);
+            CommandMetrics metrics = {
+                &Metrics::instance().counter("tempdb_requests_total", "Requests issued, by command", labels),
+                &Metrics::instance().distribution("tempdb_request_duration_seconds", "Request latency, by command", labels),
+            };
+            it = commandMetrics_.emplace(commandName_, metrics).first;
+        }
+
+        it->second.requests->add();
+        it->second.latency->record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    bool Client::sendCommand(const std::string& command, Deadline deadline) {
         try {
-            network_->sendData(command);
+            network_->sendData(command, deadline);
             return true;
+        } catch (const TimeoutError& e) {
+            // The rest of the request is flushed and its reply skipped before the next one
+            std::cerr << "Error: " << e.what() << " (" << timeout_.count() << " ms)" << std::endl;
+            return false;
         } catch (const std::runtime_error& e) {
             std::cerr << "Error sending command: " << e.what() << std::endl;
             connected_ = false;
@@ -84,29 +296,16 @@ namespace tempdb {
         }
     }
 
-    bool Client::receiveResponse() {
-        const size_t bufferSize = 1024;
-        char buffer[bufferSize];
-
-        //std::cout<<"RECIEVING: "<<std::endl;
+    bool Client::receiveResponse(Deadline deadline) {
         try {
-
-            int bytesReceived = network_->receiveData(buffer, bufferSize);
-            if (bytesReceived == 0) {
-                std::cerr << "Server closed the connection" << std::endl;
-                connected_ = false;
-                return false;
+            network_->receiveReply(reply_, deadline);
+            if (tracing_) {
+                span_.replyComplete = std::chrono::steady_clock::now();
             }
-
-            std::string response(buffer);
-
-            // Parse the response
-            auto parsedResponse = protocol_.parseResponse(response);
-
-            // Display human-readable response
-            std::string humanResponse = protocol_.humanize(parsedResponse);
-            std::cout << humanResponse << std::endl;
-
+            displayResponse(reply_);
+            return true;
+        } catch (const TimeoutError& e) {
+            std::cerr << "Error: " << e.what() << " (" << timeout_.count() << " ms)" << std::endl;
             return true;
         } catch (const std::runtime_error& e) {
             std::cerr << "Error receiving response: " << e.what() << std::endl;
@@ -115,12 +314,51 @@ namespace tempdb {
         }
     }
 
+    bool Client::executeHedged(const std::string& command, const std::string& request, Deadline deadline) {
+        try {
+            hedger_->execute(command, request, reply_, deadline);
+            if (tracing_) {
+                span_.replyComplete = std::chrono::steady_clock::now();
+            }
+            displayResponse(reply_);
+            return true;
+        } catch (const TimeoutError& e) {
+            std::cerr << "Error: " << e.what() << " (" << timeout_.count() << " ms)" << std::endl;
+            return true;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error executing command: " << e.what() << std::endl;
+            connected_ = false;
+            return false;
+        }
+    }
+
+    void Client::displayResponse(const std::string& response) {
+        // Parse the response
+        auto parsedResponse = protocol_.parseResponse(response, responsePool_);
+        if (parsedResponse.type() == RespProtocol::ResponseType::ERROR) {
+            replyErrors_.add();
+        }
+        if (codec_) {
+            parsedResponse = codec_->decodeReply(std::move(parsedResponse));
+        }
+
+        // Display human-readable response
+        protocol_.humanize(parsedResponse, std::cout);
+        std::cout << std::endl;
+
+        responsePool_.recycle(std::move(parsedResponse));
+    }
+
     void Client::displayPrompt() {
         std::cout << host_ << ":" << port_ << " > ";
         std::cout.flush();
     }
 
     void Client::handleDisconnection() {
+        if (hedger_) {
+            std::cout << "Hedged reads: " << hedger_->hedgesSent() << " sent, "
+                      << hedger_->hedgesWon() << " answered by the replica first" << std::endl;
+        }
         std::cout << "Disconnecting from server..." << std::endl;
         connected_ = false;
     }
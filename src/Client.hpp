@@ -2,9 +2,16 @@
 
 #include <string>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
+#include "Codec.hpp"
+#include "Hedger.hpp"
+#include "Metrics.hpp"
 #include "Network.hpp"
 #include "RespProtocol.hpp"
+#include "Tracer.hpp"
+#include "TrafficLog.hpp"
 
 namespace tempdb {
 
@@ -19,8 +26,20 @@ namespace tempdb {
         * @brief Constructor
         * @param host Server hostname or IP address
         * @param port Server port number
+        * @param profile Socket tuning profile
+        * @param recordPath Traffic log to record issued commands into, empty to disable
         */
-        explicit Client(const std::string& host, int port);
+        explicit Client(const std::string& host, int port, const ConnectionProfile& profile = ConnectionProfile(),
+                        const std::string& recordPath = "");
+
+        /**
+        * @brief Constructor over an established connection, e.g. one opened by Network::connectAll()
+        * @param network Connection to the server
+        * @param host Server hostname or IP address, shown in the prompt
+        * @param port Server port number
+        * @param recordPath Traffic log to record issued commands into, empty to disable
+        */
+        Client(std::unique_ptr<Network> network, const std::string& host, int port, const std::string& recordPath = "");
 
         /**
         * @brief Destructor
@@ -33,6 +52,54 @@ namespace tempdb {
         */
         int run();
 
+        /**
+        * @brief Compress large values sent and decompress them in replies
+        * @param options Compression settings
+        */
+        void enableCompression(const CodecOptions& options);
+
+        /**
+        * @brief Hedge read-only commands to a replica once they run past a latency percentile
+        * @param host Replica hostname or IP address
+        * @param port Replica port number
+        * @param profile Socket tuning profile
+        * @param percentile Latency percentile after which a read is hedged
+        * @throws std::runtime_error if the replica connection fails
+        */
+        void enableHedging(const std::string& host, int port, const ConnectionProfile& profile, double percentile);
+
+        /**
+        * @brief Hedge read-only commands over an established replica connection
+        * @param replica Connection to the replica
+        * @param percentile Latency percentile after which a read is hedged
+        */
+        void enableHedging(std::unique_ptr<Network> replica, double percentile);
+
+        /**
+        * @brief Fetch hot keys ahead of the first command
+        *
+        * All GETs go out in one pipelined write. Values found are kept in a
+        * client-side cache that answers a plain GET of the key without a round
+        * trip for a few seconds, until this client sends any other command
+        * naming the key. Best effort: a timeout only leaves fewer keys cached.
+        * @param keys Keys to fetch
+        * @return Number of keys cached
+        * @throws std::runtime_error if the connection fails
+        */
+        size_t prefetch(const std::vector<std::string>& keys);
+
+        /**
+        * @brief Read a key list, one key per line, blank lines skipped
+        * @throws std::runtime_error if the file cannot be read
+        */
+        static std::vector<std::string> loadKeys(const std::string& path);
+
+        /**
+        * @brief Fail any command that has not completed within the timeout
+        * @param timeout Per-command timeout, zero for none
+        */
+        void setTimeout(std::chrono::milliseconds timeout);
+
     private:
         /**
         * @brief Process a single user command
@@ -42,8 +109,57 @@ namespace tempdb {
         bool processCommand(const std::string& input);
 
 
-        bool sendCommand(const std::string& command);
-        bool receiveResponse();
+        bool sendCommand(const std::string& command, Deadline deadline);
+        bool receiveResponse(Deadline deadline);
+
+        /**
+        * @brief Send a read-only command through the hedger and display the reply
+        * @param command Upper-cased command name
+        * @param request RESP-encoded request
+        * @param deadline Time by which the reply must arrive
+        * @return true to continue, false on connection failure
+        */
+        bool executeHedged(const std::string& command, const std::string& request, Deadline deadline);
+
+        /**
+        * @brief Answer a GET of a prefetched key from the cache, dropping entries other commands name
+        * @return true if the command was answered
+        */
+        bool serveFromCache();
+
+        /**
+        * @brief Count the finished current command and its latency in the metrics registry
+        * @param start When the command was issued
+        */
+        void recordRequest(std::chrono::steady_clock::time_point start);
+
+        /**
+        * @brief Finish the current command's span and hand it to the tracer
+        * @param wire Whether the reply came through network_, whose wire timestamps then apply
+        */
+        void traceRequest(bool wire);
+
+        /**
+        * @brief Registry entries of one command, cached so lookups happen once
+        */
+        struct CommandMetrics {
+            Metrics::Counter* requests;
+            Metrics::Distribution* latency;
+        };
+
+        /**
+        * @brief Prefetched reply to a GET
+        */
+        struct CachedReply {
+            std::string reply;                              ///< Raw RESP reply
+            std::chrono::steady_clock::time_point expires;  ///< Served until then
+        };
+
+        /**
+        * @brief Parse, decode and print a raw RESP reply
+        */
+        void displayResponse(const std::string& response);
+
         /**
         * @brief Display connection information prompt
         */
@@ -59,6 +175,24 @@ namespace tempdb {
         int port_;                                 ///< Server port
         bool connected_;                           ///< Connection status
         RespProtocol protocol_;                    ///< RESP protocol handler
+        std::unique_ptr<TrafficLog::Writer> recorder_; ///< Traffic recorder, null when not recording
+        std::unique_ptr<Codec> codec_;             ///< Value compression, null when disabled
+        std::unique_ptr<Network> replica_;         ///< Replica connection for hedged reads, null when disabled
+        std::unique_ptr<Hedger> hedger_;           ///< Hedged read policy, null when disabled
+        std::chrono::milliseconds timeout_{0};     ///< Per-command timeout, zero for none
+
+        // Reused by every command so a steady session does not allocate
+        std::vector<std::string> tokens_;          ///< Tokens of the current command
+        std::string request_;                      ///< RESP encoding of the current command
+        std::string reply_;                        ///< Raw reply to the current command
+        RespProtocol::ResponsePool responsePool_;  ///< Storage of displayed replies
+        std::string commandName_;                  ///< Upper-cased name of the current command
+        std::unordered_map<std::string, CommandMetrics> commandMetrics_; ///< Per-command metrics by name
+        Metrics::Counter& replyErrors_;            ///< Server error replies
+        std::unordered_map<std::string, CachedReply> cache_; ///< Prefetched GET replies by key
+        Metrics::Counter& cacheHits_;              ///< GETs answered from cache_
+        bool tracing_;                             ///< Record a span per command
+        Tracer::Span span_;                        ///< Span of the current command
     };
 
 } // namespace tempdb
@@ -0,0 +1,149 @@
+#include "Codec.hpp"
+#include "Lz4.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        // Header: 4 byte magic, 4 byte dictionary id, 4 byte original size (little endian)
+        const char kMagic[4] = {'\x1b', 'T', 'Z', '\x01'};
+        const size_t kHeaderSize = 12;
+
+        void appendUint32(std::string& out, uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+            }
+        }
+
+        uint32_t readUint32(const char* p) {
+            uint32_t value = 0;
+            for (int i = 0; i < 4; ++i) {
+                value |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        uint32_t fnv1a(const std::string& data) {
+            uint32_t hash = 2166136261u;
+            for (char c : data) {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+            }
+            return hash ? hash : 1;
+        }
+
+        /**
+         * @brief Which arguments of a command are values
+         * @return First value index and stride, {0, 0} if the command carries no values
+         */
+        std::pair<size_t, size_t> valuePositions(std::string name) {
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::toupper(c); });
+
+            if (name == "SET" || name == "SETNX" || name == "GETSET") {
+                return {2, 0};      // SET key value [options]
+            }
+            if (name == "SETEX" || name == "PSETEX") {
+                return {3, 0};      // SETEX key seconds value
+            }
+            if (name == "MSET" || name == "MSETNX") {
+                return {2, 2};      // MSET key value [key value ...]
+            }
+            if (name == "HSET" || name == "HMSET") {
+                return {3, 2};      // HSET key field value [field value ...]
+            }
+            if (name == "LPUSH" || name == "RPUSH") {
+                return {2, 1};      // LPUSH key value [value ...]
+            }
+            return {0, 0};
+        }
+
+    } // namespace
+
+    Codec::Codec(const CodecOptions& options)
+        : options_(options), dictionaryId_(options.dictionary.empty() ? 0 : fnv1a(options.dictionary)) {
+    }
+
+    void Codec::encodeCommand(std::vector<std::string>& tokens) const {
+        if (tokens.empty()) {
+            return;
+        }
+
+        auto positions = valuePositions(tokens[0]);
+        if (positions.first == 0) {
+            return;
+        }
+
+        size_t stride = positions.second ? positions.second : tokens.size();
+        for (size_t i = positions.first; i < tokens.size(); i += stride) {
+            if (tokens[i].size() >= options_.threshold) {
+                tokens[i] = compress(tokens[i]);
+            }
+        }
+    }
+
+    RespProtocol::Response Codec::decodeReply(RespProtocol::Response&& response) const {
+        using ResponseType = RespProtocol::ResponseType;
+
+        if (response.type() == ResponseType::BULK_STRING) {
+            std::string original;
+            if (decompress(response.text(), original)) {
+                return RespProtocol::Response::string(ResponseType::BULK_STRING, original);
+            }
+        } else if (response.type() == ResponseType::ARRAY) {
+            auto elements = response.releaseElements();
+            for (auto& element : elements) {
+                element = decodeReply(std::move(element));
+            }
+            return RespProtocol::Response::array(std::move(elements));
+        }
+
+        return std::move(response);
+    }
+
+    std::string Codec::compress(const std::string& value) const {
+        std::string block = Lz4::compress(value, options_.dictionary);
+        if (block.size() + kHeaderSize >= value.size()) {
+            return value;
+        }
+
+        std::string out;
+        out.reserve(kHeaderSize + block.size());
+        out.append(kMagic, sizeof(kMagic));
+        appendUint32(out, dictionaryId_);
+        appendUint32(out, static_cast<uint32_t>(value.size()));
+        out.append(block);
+        return out;
+    }
+
+    bool Codec::decompress(std::string_view value, std::string& out) const {
+        if (value.size() < kHeaderSize || std::memcmp(value.data(), kMagic, sizeof(kMagic)) != 0) {
+            return false;
+        }
+        if (readUint32(value.data() + 4) != dictionaryId_) {
+            return false;
+        }
+
+        try {
+            out = Lz4::decompress(value.substr(kHeaderSize), readUint32(value.data() + 8), options_.dictionary);
+            return true;
+        } catch (const std::runtime_error&) {
+            // Not one of ours after all, hand the value back as stored
+            return false;
+        }
+    }
+
+    std::string Codec::loadDictionary(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Error: Could not open compression dictionary: " + path);
+        }
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+} // namespace tempdb
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RespProtocol.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Settings for client-side value compression
+    */
+    struct CodecOptions {
+        size_t threshold = 1024;    ///< Values shorter than this are sent as typed
+        std::string dictionary;     ///< Optional shared LZ4 dictionary, empty for none
+    };
+
+    /**
+    * @brief Transparent compression of large values
+    *
+    * Values of value-bearing commands (SET, MSET, HSET, ...) that are at least
+    * the threshold long are LZ4-compressed and prefixed with a small header
+    * (magic, dictionary id, original size). Bulk-string replies carrying that
+    * header are decompressed on the way back, so callers only ever see the
+    * original value. Keys and all other arguments are never touched.
+    */
+    class Codec {
+    public:
+        /**
+        * @brief Constructor
+        * @param options Compression settings
+        */
+        explicit Codec(const CodecOptions& options);
+
+        /**
+        * @brief Compress the value arguments of a tokenized command in place
+        * @param tokens Command name followed by its arguments
+        */
+        void encodeCommand(std::vector<std::string>& tokens) const;
+
+        /**
+        * @brief Decompress every compressed bulk string in a reply
+        * @param response Parsed reply, consumed
+        * @return Reply with original values restored
+        */
+        RespProtocol::Response decodeReply(RespProtocol::Response&& response) const;
+
+        /**
+        * @brief Compress a single value if that makes it smaller
+        * @param value Value to compress
+        * @return Header and compressed block, or the value unchanged
+        */
+        std::string compress(const std::string& value) const;
+
+        /**
+        * @brief Decompress a value produced by compress()
+        * @param value Possibly compressed value
+        * @param out Original value
+        * @return false if the value is not compressed or was compressed with another dictionary
+        */
+        bool decompress(std::string_view value, std::string& out) const;
+
+        /**
+        * @brief Load a dictionary file
+        * @param path Dictionary file path, typically concatenated sample values
+        * @return Dictionary contents
+        * @throws std::runtime_error if the file cannot be read
+        */
+        static std::string loadDictionary(const std::string& path);
+
+    private:
+        CodecOptions options_;      ///< Compression settings
+        uint32_t dictionaryId_;     ///< Hash of the dictionary, 0 for none
+    };
+
+} // namespace tempdb
@@ -0,0 +1,88 @@
+#include "FanOut.hpp"
+#include "RespProtocol.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        const std::chrono::milliseconds kDefaultTimeout(5000);
+
+        double toMillis(std::chrono::steady_clock::duration duration) {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        }
+
+    } // namespace
+
+    FanOut::FanOut(const std::vector<std::pair<std::string, int>>& servers, std::chrono::milliseconds timeout,
+                   const ConnectionProfile& profile)
+        : servers_(servers), timeout_(timeout.count() > 0 ? timeout : kDefaultTimeout), profile_(profile) {
+
+        if (servers.empty()) {
+            throw std::runtime_error("Fan-out needs at least one server");
+        }
+
+        // A few dozen nodes each printing their connect diagnostics would only interleave
+        profile_.quiet = true;
+    }
+
+    int FanOut::run(const std::string& command) {
+        auto tokens = RespProtocol::splitInput(command);
+        if (tokens.empty()) {
+            throw std::runtime_error("Fan-out command cannot be empty");
+        }
+        std::string request = RespProtocol::encodeArray(tokens);
+
+        std::vector<NodeResult> results(servers_.size());
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        Deadline deadline = start + timeout_;
+
+        // Name resolution and connect block per node, so each node gets its own thread
+        for (size_t i = 0; i < servers_.size(); ++i) {
+            workers.emplace_back(&FanOut::queryNode, this, std::cref(servers_[i]), std::cref(request), deadline,
+                                 std::ref(results[i]));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        size_t replied = 0;
+        std::cout << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < servers_.size(); ++i) {
+            const auto& result = results[i];
+            std::cout << "[" << servers_[i].first << ":" << servers_[i].second << "] ("
+                      << toMillis(result.elapsed) << " ms) " << result.output << std::endl;
+            replied += result.replied;
+        }
+        std::cout << "Replied: " << replied << "/" << servers_.size() << " nodes in " << toMillis(elapsed)
+                  << " ms" << std::endl;
+
+        return replied == servers_.size() ? 0 : 1;
+    }
+
+    void FanOut::queryNode(const std::pair<std::string, int>& server, const std::string& request, Deadline deadline,
+                           NodeResult& result) {
+        auto start = std::chrono::steady_clock::now();
+
+        try {
+            Network network(server.first, server.second, profile_, deadline);
+            network.sendData(request, deadline);
+            auto response = RespProtocol::parseResponse(network.receiveReply(deadline));
+            result.output = RespProtocol::humanize(response);
+            result.replied = true;
+        } catch (const TimeoutError& e) {
+            result.output = "Error: " + std::string(e.what()) + " (" + std::to_string(timeout_.count()) + " ms)";
+        } catch (const std::runtime_error& e) {
+            result.output = e.what();
+        }
+
+        result.elapsed = std::chrono::steady_clock::now() - start;
+    }
+
+} // namespace tempdb
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+
+#include "Network.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Runs one command on a list of servers at once
+    *
+    * Every node is resolved, connected and queried concurrently, each bounded by
+    * the same per-node timeout (connect included), so the whole run takes about
+    * one round trip to the slowest node rather than the sum of them. Replies are
+    * printed tagged with their node, in the order the servers were given.
+    */
+    class FanOut {
+    public:
+        /**
+        * @brief Constructor
+        * @param servers Host and port of every node
+        * @param timeout Per-node timeout, zero for the default of 5 seconds
+        * @param profile Socket tuning profile
+        */
+        FanOut(const std::vector<std::pair<std::string, int>>& servers, std::chrono::milliseconds timeout,
+               const ConnectionProfile& profile = ConnectionProfile());
+
+        /**
+        * @brief Run a command on every node and print the tagged replies
+        * @param command Command line, e.g. "INFO" or "FLUSHALL"
+        * @return Exit status (0 if every node replied, non-zero otherwise)
+        */
+        int run(const std::string& command);
+
+    private:
+        /**
+        * @brief Outcome of the command on one node
+        */
+        struct NodeResult {
+            std::string output;                         ///< Humanized reply or failure description
+            bool replied = false;                       ///< A reply arrived before the timeout
+            std::chrono::steady_clock::duration elapsed{}; ///< Time until the reply or failure
+        };
+
+        /**
+        * @brief Connect to one node, send the request and wait for its reply
+        */
+        void queryNode(const std::pair<std::string, int>& server, const std::string& request, Deadline deadline,
+                       NodeResult& result);
+
+        std::vector<std::pair<std::string, int>> servers_;  ///< Nodes to query
+        std::chrono::milliseconds timeout_;                 ///< Per-node timeout
+        ConnectionProfile profile_;                         ///< Socket tuning profile
+    };
+
+} // namespace tempdb
@@ -0,0 +1,163 @@
+#include "Hedger.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <poll.h>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace tempdb {
+
+    namespace {
+
+        // Commands seen fewer times than this are never hedged: their percentile is not meaningful yet
+        const uint64_t kMinSamples = 20;
+
+        /**
+         * @brief Wait until a connection has a complete reply or the deadline passes
+         * @return true if a reply was received
+         */
+        bool waitForReply(Network& network, Deadline deadline, std::string& reply) {
+            while (!network.tryReceiveReply(reply)) {
+                if (!network.waitReadable(deadline)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    } // namespace
+
+    Hedger::Hedger(Network& primary, Network& replica, double percentile)
+        : primary_(primary), replica_(replica), replicaHealthy_(true), percentile_(percentile),
+          hedgesSent_(0), hedgesWon_(0) {
+    }
+
+    bool Hedger::isReadOnly(const std::string& command) {
+        static const std::unordered_set<std::string> readOnly = {
+            "GET", "MGET", "EXISTS", "TTL", "PTTL", "STRLEN", "TYPE", "KEYS",
+            "HGET", "HMGET", "HGETALL", "HEXISTS", "HLEN", "HKEYS", "HVALS",
+            "LRANGE", "LLEN", "LINDEX", "SMEMBERS", "SISMEMBER", "SCARD",
+            "ZRANGE", "ZSCORE", "ZCARD", "ZRANK",
+        };
+        return readOnly.count(command) > 0;
+    }
+
+    void Hedger::execute(const std::string& command, const std::string& request, std::string& reply,
+                         Deadline deadline) {
+        auto start = std::chrono::steady_clock::now();
+
+        // One lookup per read, inserting (and allocating) only the first time a command is seen
+        Histogram& latency = latency_[command];
+
+        primary_.sendData(request, deadline);
+
+        bool received = false;
+        auto delay = hedgeDelay(latency);
+
+        if (replicaHealthy_ && delay > std::chrono::nanoseconds::zero()) {
+            received = waitForReply(primary_, std::min<Deadline>(start + delay, deadline), reply);
+
+            if (!received && std::chrono::steady_clock::now() < deadline) {
+                bool hedged = false;
+                try {
+                    replica_.sendData(request, deadline);
+                    ++hedgesSent_;
+                    hedged = true;
+                } catch (const TimeoutError&) {
+                    // Out of time for the hedge, the primary may still make it
+                } catch (const std::runtime_error&) {
+                    replicaHealthy_ = false;
+                }
+
+                if (hedged) {
+                    if (race(reply, deadline)) {
+                        ++hedgesWon_;
+                    }
+                    received = true;
+                }
+            }
+        }
+
+        if (!received) {
+            primary_.receiveReply(reply, deadline);
+        }
+
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::chrono::nanoseconds Hedger::hedgeDelay(const Histogram& latency) const {
+        if (latency.count() < kMinSamples) {
+            return std::chrono::nanoseconds::zero();
+        }
+        return std::chrono::nanoseconds(latency.valueAtPercentile(percentile_));
+    }
+
+    bool Hedger::race(std::string& reply, Deadline deadline) {
+        // Set once the primary fails: the replica may still answer in time
+        std::exception_ptr primaryError;
+
+        while (true) {
+            if (!primaryError) {
+                try {
+                    if (primary_.tryReceiveReply(reply)) {
+                        if (replicaHealthy_) {
+                            replica_.discardNextReply();
+                        }
+                        return false;
+                    }
+                } catch (const std::runtime_error&) {
+                    primaryError = std::current_exception();
+                }
+            }
+
+            if (replicaHealthy_) {
+                try {
+                    if (replica_.tryReceiveReply(reply)) {
+                        if (!primaryError) {
+                            primary_.discardNextReply();
+                        }
+                        return true;
+                    }
+                } catch (const std::runtime_error&) {
+                    // Keep waiting on the primary alone
+                    replicaHealthy_ = false;
+                }
+            }
+
+            if (primaryError && !replicaHealthy_) {
+                std::rethrow_exception(primaryError);
+            }
+
+            int timeoutMillis = -1;
+            if (deadline != kNoDeadline) {
+                auto remaining = deadline - std::chrono::steady_clock::now();
+                if (remaining <= std::chrono::steady_clock::duration::zero()) {
+                    if (primaryError) {
+                        std::rethrow_exception(primaryError);
+                    }
+                    // Neither reply made it: both will be skipped when they arrive
+                    primary_.discardNextReply();
+                    if (replicaHealthy_) {
+                        replica_.discardNextReply();
+                    }
+                    throw TimeoutError("Request timed out waiting for the reply");
+                }
+                timeoutMillis = static_cast<int>(
+                    std::chrono::ceil<std::chrono::milliseconds>(remaining).count());
+            }
+
+            pollfd fds[2];
+            nfds_t count = 0;
+            if (!primaryError) {
+                fds[count++] = {primary_.fd(), POLLIN, 0};
+            }
+            if (replicaHealthy_) {
+                fds[count++] = {replica_.fd(), POLLIN, 0};
+            }
+            poll(fds, count, timeoutMillis);
+        }
+    }
+
+} // namespace tempdb
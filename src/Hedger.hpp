@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <unordered_map>
+
+#include "Histogram.hpp"
+#include "Network.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Hedged reads across a primary and a replica connection
+    *
+    * A read-only command goes to the primary first. If no reply has arrived once
+    * the command's own latency percentile (p95 by default) has passed, the same
+    * request is sent to the replica and whichever reply comes first is used. The
+    * losing connection is told to discard its reply when it arrives, so both stay
+    * in sync for later requests.
+    */
+    class Hedger {
+    public:
+        /**
+        * @brief Constructor
+        * @param primary Primary connection, must outlive the hedger
+        * @param replica Replica connection, must outlive the hedger
+        * @param percentile Latency percentile after which a read is hedged
+        */
+        Hedger(Network& primary, Network& replica, double percentile = 95);
+
+        /**
+        * @brief Whether a command only reads data and may be sent to a replica
+        * @param command Upper-cased command name
+        */
+        static bool isReadOnly(const std::string& command);
+
+        /**
+        * @brief Send a read and return the first reply from either connection
+        * @param command Upper-cased command name, used to keep per-command latency
+        * @param request RESP-encoded request
+        * @param reply Replaced by the raw RESP reply
+        * @param deadline Time by which a reply must arrive from either connection
+        * @throws TimeoutError if neither connection replies before the deadline
+        * @throws std::runtime_error if the primary fails and no replica reply is available
+        */
+        void execute(const std::string& command, const std::string& request, std::string& reply,
+                     Deadline deadline = kNoDeadline);
+
+        size_t hedgesSent() const { return hedgesSent_; }
+        size_t hedgesWon() const { return hedgesWon_; }
+
+    private:
+        /**
+        * @brief How long to wait for the primary before hedging, or zero to never hedge
+        * @param latency The command's observed latency
+        */
+        std::chrono::nanoseconds hedgeDelay(const Histogram& latency) const;
+
+        /**
+        * @brief Wait for whichever connection replies first after a hedge was sent
+        * @param reply Set to the winning reply
+        * @param deadline Time to give up on both
+        * @return true if the replica won
+        * @throws TimeoutError if neither replies before the deadline
+        * @throws std::runtime_error the primary's error if it failed and the replica did not answer in time
+        */
+        bool race(std::string& reply, Deadline deadline);
+
+        Network& primary_;                                      ///< Connection every read goes to first
+        Network& replica_;                                      ///< Connection hedged reads go to
+        bool replicaHealthy_;                                   ///< Cleared after a replica failure
+        double percentile_;                                     ///< Hedge after this latency percentile
+        std::unordered_map<std::string, Histogram> latency_;    ///< Observed latency per command, in ns
+        size_t hedgesSent_;                                     ///< Reads sent to the replica
+        size_t hedgesWon_;                                      ///< Hedged reads answered by the replica first
+    };
+
+} // namespace tempdb
@@ -0,0 +1,177 @@
+#include "Histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        const size_t kLinearBuckets = 2048;    // Values below this are counted exactly
+        const size_t kSubBuckets = 1024;       // Buckets per power of two above that
+        const int kSubBucketBits = 10;
+        const int kTicksPerHalfDistance = 5;   // Reporting density of exportPercentiles
+
+    } // namespace
+
+    Histogram::Histogram()
+        : count_(0), min_(std::numeric_limits<uint64_t>::max()), max_(0), sum_(0), sumOfSquares_(0) {
+    }
+
+    size_t Histogram::indexOf(uint64_t value) {
+        if (value < kLinearBuckets) {
+            return value;
+        }
+
+        int highestBit = 63 - __builtin_clzll(value);
+        int shift = highestBit - kSubBucketBits;
+        size_t subBucket = (value >> shift) - kSubBuckets;
+        return kLinearBuckets + (shift - 1) * kSubBuckets + subBucket;
+    }
+
+    uint64_t Histogram::highestEquivalent(size_t index) {
+        if (index < kLinearBuckets) {
+            return index;
+        }
+
+        int shift = static_cast<int>((index - kLinearBuckets) / kSubBuckets) + 1;
+        uint64_t subBucket = (index - kLinearBuckets) % kSubBuckets + kSubBuckets;
+        return (subBucket << shift) + (uint64_t(1) << shift) - 1;
+    }
+
+    void Histogram::record(uint64_t value) {
+        size_t index = indexOf(value);
+
+        // Grow on demand so histograms of small values stay small
+        if (index >= counts_.size()) {
+            counts_.resize(index + 1, 0);
+        }
+
+        ++counts_[index];
+        ++count_;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sum_ += static_cast<double>(value);
+        sumOfSquares_ += static_cast<double>(value) * static_cast<double>(value);
+    }
+
+    void Histogram::merge(const Histogram& other) {
+        if (other.counts_.size() > counts_.size()) {
+            counts_.resize(other.counts_.size(), 0);
+        }
+
+        for (size_t i = 0; i < other.counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+        sumOfSquares_ += other.sumOfSquares_;
+    }
+
+    double Histogram::mean() const {
+        return count_ ? sum_ / count_ : 0.0;
+    }
+
+    double Histogram::stdDeviation() const {
+        if (count_ == 0) {
+            return 0.0;
+        }
+
+        double average = mean();
+        return std::sqrt(std::max(0.0, sumOfSquares_ / count_ - average * average));
+    }
+
+    uint64_t Histogram::valueAtPercentile(double percentile) const {
+        if (count_ == 0) {
+            return 0;
+        }
+
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count_)));
+
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            cumulative += counts_[i];
+            if (cumulative >= target) {
+                return std::min(highestEquivalent(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    void Histogram::exportPercentiles(std::ostream& out, double unitScale) const {
+        out << std::fixed;
+        out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+
+        double nextPercentile = 0.0;
+        uint64_t cumulative = 0;
+
+        for (size_t i = 0; i < counts_.size() && cumulative < count_; ++i) {
+            if (counts_[i] == 0) {
+                continue;
+            }
+
+            cumulative += counts_[i];
+            double reached = 100.0 * cumulative / count_;
+            double value = std::min(highestEquivalent(i), max_) / unitScale;
+
+            while (cumulative < count_ && reached >= nextPercentile) {
+                out << std::setw(12) << std::setprecision(3) << value << " "
+                    << std::setw(14) << std::setprecision(12) << nextPercentile / 100.0 << " "
+                    << std::setw(10) << cumulative << " "
+                    << std::setw(14) << std::setprecision(2) << 1.0 / (1.0 - nextPercentile / 100.0) << "\n";
+
+                // Report twice as densely for every halving of the remaining distance to 100%
+                double halvings = std::floor(std::log2(100.0 / (100.0 - nextPercentile)));
+                nextPercentile += 100.0 / (kTicksPerHalfDistance * std::pow(2.0, halvings + 1));
+            }
+
+            if (cumulative == count_) {
+                out << std::setw(12) << std::setprecision(3) << value << " "
+                    << std::setw(14) << std::setprecision(12) << 1.0 << " "
+                    << std::setw(10) << cumulative << "\n";
+            }
+        }
+
+        out << std::setprecision(3);
+        out << "#[Mean    = " << std::setw(12) << mean() / unitScale
+            << ", StdDeviation   = " << std::setw(12) << stdDeviation() / unitScale << "]\n";
+        out << "#[Max     = " << std::setw(12) << max_ / unitScale
+            << ", Total count    = " << std::setw(12) << count_ << "]\n";
+        out << "#[Buckets = " << std::setw(12) << counts_.size()
+            << ", SubBuckets     = " << std::setw(12) << kLinearBuckets << "]\n";
+    }
+
+    std::string Histogram::summary(double unitScale) const {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1);
+        oss << "p50 " << valueAtPercentile(50) / unitScale
+            << "  p90 " << valueAtPercentile(90) / unitScale
+            << "  p99 " << valueAtPercentile(99) / unitScale
+            << "  p99.9 " << valueAtPercentile(99.9) / unitScale
+            << "  p99.99 " << valueAtPercentile(99.99) / unitScale
+            << "  max " << max_ / unitScale;
+        return oss.str();
+    }
+
+    void Histogram::exportToFile(const std::string& path, double unitScale) const {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Error: Could not open histogram file for writing: " + path);
+        }
+
+        exportPercentiles(out, unitScale);
+        if (!out) {
+            throw std::runtime_error("Error: Failed to write histogram file: " + path);
+        }
+    }
+
+} // namespace tempdb
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tempdb {
+
+    /**
+    * @brief HDR-style latency histogram
+    *
+    * Values are bucketed log-linearly with 1024-2048 sub-buckets per power of two,
+    * so every recorded value is kept to three significant digits. Memory does
+    * not depend on how many values are recorded, only on the largest: buckets
+    * are added on demand up to the one holding it, about 8 KB per power of two
+    * above 2048.
+    */
+    class Histogram {
+    public:
+        Histogram();
+
+        /**
+        * @brief Record a single value
+        * @param value Value to record, e.g. a latency in nanoseconds
+        */
+        void record(uint64_t value);
+
+        /**
+        * @brief Add every value recorded in another histogram
+        */
+        void merge(const Histogram& other);
+
+        uint64_t count() const { return count_; }
+        uint64_t min() const { return count_ ? min_ : 0; }
+        uint64_t max() const { return max_; }
+        double mean() const;
+        double stdDeviation() const;
+
+        /**
+        * @brief Value at or below which the given share of recorded values fall
+        * @param percentile Percentile in [0, 100]
+        */
+        uint64_t valueAtPercentile(double percentile) const;
+
+        /**
+        * @brief Write the percentile distribution in HdrHistogram text format
+        *
+        * The output can be loaded by the HdrHistogram plotter and other tools
+        * that read `outputPercentileDistribution` files.
+        * @param out Output stream
+        * @param unitScale Divisor applied to every value, e.g. 1000 to print ns as us
+        */
+        void exportPercentiles(std::ostream& out, double unitScale) const;
+
+        /**
+        * @brief One-line summary of the usual tail percentiles
+        * @param unitScale Divisor applied to every value, e.g. 1000 to print ns as us
+        */
+        std::string summary(double unitScale) const;
+
+        /**
+        * @brief Export the percentile distribution to a file
+        * @param path Output file path
+        * @param unitScale Divisor applied to every value
+        * @throws std::runtime_error if the file cannot be written
+        */
+        void exportToFile(const std::string& path, double unitScale) const;
+
+    private:
+        static size_t indexOf(uint64_t value);
+        static uint64_t highestEquivalent(size_t index);
+
+        std::vector<uint64_t> counts_;  ///< Count per bucket
+        uint64_t count_;                ///< Total recorded values
+        uint64_t min_;                  ///< Smallest recorded value
+        uint64_t max_;                  ///< Largest recorded value
+        double sum_;                    ///< Sum of recorded values
+        double sumOfSquares_;           ///< Sum of squared recorded values
+    };
+
+} // namespace tempdb
@@ -0,0 +1,197 @@
+#include "LoadGenerator.hpp"
+#include "Metrics.hpp"
+#include "RespProtocol.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <stdexcept>
+
+namespace tempdb {
+
+    LoadGenerator::LoadGenerator(const std::string& host, int port, const LoadOptions& options,
+                                 const ConnectionProfile& profile)
+        : host_(host), port_(port), options_(options), profile_(profile) {
+
+        if (options.rate <= 0 || options.durationSeconds <= 0 || options.connections <= 0) {
+            throw std::runtime_error("Invalid load settings");
+        }
+
+        auto tokens = RespProtocol::splitInput(options.command);
+        if (tokens.empty()) {
+            throw std::runtime_error("Load command cannot be empty");
+        }
+        encodedCommand_ = RespProtocol::encodeArray(tokens);
+    }
+
+    int LoadGenerator::run(const std::string& histogramPath) {
+        auto timeout = std::chrono::milliseconds(options_.timeoutMillis);
+        auto networks = Network::connectAll(
+            std::vector<std::pair<std::string, int>>(options_.connections, {host_, port_}), profile_,
+            timeout.count() > 0 ? std::chrono::steady_clock::now() + timeout : kNoDeadline);
+        // No batching window: requests go out as soon as the I/O thread gets to them, and only
+        // those submitted while it was busy share a write, so coalescing never delays a request
+        BatchOptions batchOptions;
+        batchOptions.window = std::chrono::microseconds(0);
+
+        std::vector<std::unique_ptr<Connection>> connections;
+        for (auto& network : networks) {
+            connections.push_back(std::make_unique<Connection>());
+            connections.back()->network = std::move(network);
+            connections.back()->batcher = std::make_unique<Batcher>(*connections.back()->network, batchOptions);
+        }
+
+        std::cout << "Offering " << options_.rate << " requests/s of '" << options_.command << "' for "
+                  << options_.durationSeconds << " s over " << options_.connections << " connection(s) ("
+                  << (options_.poisson ? "poisson" : "constant") << " arrivals)" << std::endl;
+
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < options_.connections; ++i) {
+            threads.emplace_back(&LoadGenerator::receiveLoop, this, std::ref(*connections[i]));
+            threads.emplace_back(&LoadGenerator::sendLoop, this, std::ref(*connections[i]), i, start);
+        }
+
+        // Keep the metrics file current while the load runs, so the in-flight and
+        // pipeline depth gauges can be watched rather than only read once at exit
+        if (!options_.metricsPath.empty()) {
+            auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(options_.durationSeconds));
+            for (auto next = start + std::chrono::seconds(1); next < end; next += std::chrono::seconds(1)) {
+                std::this_thread::sleep_until(next);
+                try {
+                    Metrics::instance().writeToFile(options_.metricsPath);
+                } catch (const std::runtime_error& e) {
+                    std::cerr << e.what() << std::endl;
+                    break;
+                }
+            }
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Histogram latency;
+        Histogram sendLag;
+        size_t errorReplies = 0;
+        size_t timeouts = 0;
+        bool failed = false;
+
+        for (size_t i = 0; i < connections.size(); ++i) {
+            const auto& connection = *connections[i];
+            latency.merge(connection.latency);
+            sendLag.merge(connection.sendLag);
+            errorReplies += connection.errorReplies;
+            timeouts += connection.timeouts;
+            if (!connection.failure.empty()) {
+                std::cerr << "Connection " << i << " failed: " << connection.failure << std::endl;
+                failed = true;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Completed:     " << latency.count() << " requests (" << errorReplies << " error replies, "
+                  << timeouts << " timed out)" << std::endl;
+        std::cout << "Achieved rate: " << (seconds > 0 ? latency.count() / seconds : 0.0) << " requests/s (target "
+                  << options_.rate << ")" << std::endl;
+        std::cout << "Latency (us):  " << latency.summary(1000.0) << std::endl;
+        std::cout << "Send lag (us): p99 " << sendLag.valueAtPercentile(99) / 1000.0 << "  max "
+                  << sendLag.max() / 1000.0 << std::endl;
+
+        if (!histogramPath.empty()) {
+            latency.exportToFile(histogramPath, 1000.0);
+            std::cout << "Latency histogram (us) written to " << histogramPath << std::endl;
+        }
+
+        return failed ? 1 : 0;
+    }
+
+    void LoadGenerator::sendLoop(Connection& connection, int index, std::chrono::steady_clock::time_point start) {
+        using Clock = std::chrono::steady_clock;
+
+        // Each connection carries an equal share of the rate, staggered so they do not fire together
+        double meanGapSeconds = options_.connections / options_.rate;
+        auto toDuration = [](double seconds) {
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        };
+
+        std::mt19937_64 random(index + 1);
+        std::exponential_distribution<double> exponential(1.0 / meanGapSeconds);
+
+        auto timeout = std::chrono::milliseconds(options_.timeoutMillis);
+        auto end = start + toDuration(options_.durationSeconds);
+        auto intended = start + toDuration(index / options_.rate);
+
+        while (intended < end) {
+            std::this_thread::sleep_until(intended);
+
+            {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                if (!connection.failure.empty()) {
+                    break;
+                }
+            }
+
+            auto completion = connection.batcher->submit(encodedCommand_,
+                                                          timeout.count() > 0 ? intended + timeout : kNoDeadline);
+            {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                connection.requests.push_back({intended, std::move(completion)});
+            }
+            connection.sent.notify_one();
+
+            connection.sendLag.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - intended).count());
+
+            intended += toDuration(options_.poisson ? exponential(random) : meanGapSeconds);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.sendingDone = true;
+        }
+        connection.sent.notify_one();
+    }
+
+    void LoadGenerator::receiveLoop(Connection& connection) {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(connection.mutex);
+                connection.sent.wait(lock, [&connection] {
+                    return connection.sendingDone || !connection.requests.empty();
+                });
+                if (connection.requests.empty()) {
+                    break;
+                }
+                request = std::move(connection.requests.front());
+                connection.requests.pop_front();
+            }
+
+            // Replies complete in order, but a slot may be observed late behind a timed-out
+            // one, so latency runs to when the reply was parsed rather than to now
+            try {
+                auto response = request.completion->wait();
+
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                connection.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    request.completion->completedAt() - request.intended).count());
+                if (response.type() == RespProtocol::ResponseType::ERROR) {
+                    ++connection.errorReplies;
+                }
+            } catch (const TimeoutError&) {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                ++connection.timeouts;
+            } catch (const std::runtime_error& e) {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                connection.failure = e.what();
+                break;
+            }
+        }
+    }
+
+} // namespace tempdb
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "Batcher.hpp"
+#include "Histogram.hpp"
+#include "Network.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Settings for an open-loop load run
+    */
+    struct LoadOptions {
+        double rate = 1000;                 ///< Target requests per second across all connections
+        double durationSeconds = 10;        ///< How long to keep issuing requests
+        bool poisson = false;               ///< Exponential inter-arrival times instead of a fixed interval
+        int connections = 1;                ///< Number of parallel connections
+        std::string command = "PING";       ///< Command issued on every request
+        int timeoutMillis = 0;              ///< Requests unanswered this long after their intended send time fail, 0 for none
+        std::string metricsPath;            ///< Metrics file rewritten every second during the run, empty for none
+    };
+
+    /**
+    * @brief Open-loop, rate-controlled load generator
+    *
+    * Requests are scheduled at fixed intended send times that do not depend on
+    * how fast the server replies, and latency is measured from the intended send
+    * time rather than the actual one. A stalled server therefore shows up as the
+    * queueing delay real clients would see instead of silently lowering the
+    * offered load (coordinated omission).
+    *
+    * Each connection is driven through a Batcher: requests are pipelined, with
+    * whatever was submitted while the previous write or reply was in progress
+    * going out in one write, and the pipeline depth adapts to the connection.
+    */
+    class LoadGenerator {
+    public:
+        /**
+        * @brief Constructor
+        * @param host Server hostname or IP address
+        * @param port Server port number
+        * @param options Load settings
+        * @param profile Socket tuning profile
+        */
+        LoadGenerator(const std::string& host, int port, const LoadOptions& options,
+                      const ConnectionProfile& profile = ConnectionProfile());
+
+        /**
+        * @brief Run the load and print the achieved rate and latency
+        * @param histogramPath File to export the latency distribution to, empty to skip
+        * @return Exit status (0 for success, non-zero for error)
+        */
+        int run(const std::string& histogramPath = "");
+
+    private:
+        /**
+        * @brief A submitted request, awaiting its reply
+        */
+        struct Request {
+            std::chrono::steady_clock::time_point intended;             ///< Intended send time
+            std::shared_ptr<Batcher::Completion> completion;            ///< Completed by the batcher
+        };
+
+        /**
+        * @brief State shared by the sender and receiver of one connection
+        */
+        struct Connection {
+            std::unique_ptr<Network> network;                           ///< The connection
+            std::unique_ptr<Batcher> batcher;                           ///< Pipelines the requests on network
+            std::mutex mutex;                                           ///< Guards the members below
+            std::condition_variable sent;                               ///< Signalled on every submission
+            std::deque<Request> requests;                               ///< Requests awaiting replies, in send order
+            bool sendingDone = false;                                   ///< Sender has stopped
+            Histogram latency;                                          ///< Latency from intended send, in ns
+            Histogram sendLag;                                          ///< Actual minus intended submission time, in ns
+            size_t errorReplies = 0;                                    ///< Replies of type ERROR
+            size_t timeouts = 0;                                        ///< Requests that missed their deadline
+            std::string failure;                                        ///< Connection failure, empty if none
+        };
+
+        void sendLoop(Connection& connection, int index, std::chrono::steady_clock::time_point start);
+        void receiveLoop(Connection& connection);
+
+        std::string host_;              ///< Server hostname
+        int port_;                      ///< Server port
+        LoadOptions options_;           ///< Load settings
+        ConnectionProfile profile_;     ///< Socket tuning profile
+        std::string encodedCommand_;    ///< RESP encoding of options_.command
+    };
+
+} // namespace tempdb
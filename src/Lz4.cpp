@@ -0,0 +1,209 @@
+#include "Lz4.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace tempdb {
+
+namespace {
+
+const size_t kMinMatch = 4;
+const size_t kMaxOffset = 65535;
+const size_t kLastLiterals = 5;    // The block must end with at least this many literals
+const size_t kMatchFindLimit = 12; // No match may start this close to the end
+const size_t kMaxExpansion = 255;  // Output bytes per block byte at most, from 255-valued length bytes
+const int kHashLog = 12;
+
+uint32_t read32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+void writeLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void writeSequence(std::string& out, const char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t extraMatch = matchLength - kMinMatch;
+    uint8_t token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+    token |= static_cast<uint8_t>(extraMatch < 15 ? extraMatch : 15);
+    out.push_back(static_cast<char>(token));
+
+    if (literalLength >= 15) {
+        writeLength(out, literalLength - 15);
+    }
+    out.append(literals, literalLength);
+
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+
+    if (extraMatch >= 15) {
+        writeLength(out, extraMatch - 15);
+    }
+}
+
+void writeLastLiterals(std::string& out, const char* literals, size_t literalLength) {
+    out.push_back(static_cast<char>((literalLength < 15 ? literalLength : 15) << 4));
+    if (literalLength >= 15) {
+        writeLength(out, literalLength - 15);
+    }
+    out.append(literals, literalLength);
+}
+
+size_t readLength(std::string_view block, size_t& pos) {
+    size_t length = 0;
+    uint8_t byte;
+    do {
+        if (pos >= block.size()) {
+            throw std::runtime_error("LZ4 block truncated");
+        }
+        byte = static_cast<uint8_t>(block[pos++]);
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+} // namespace
+
+std::string Lz4::compress(std::string_view input, std::string_view dictionary) {
+    if (dictionary.size() > kMaxOffset) {
+        dictionary = dictionary.substr(dictionary.size() - kMaxOffset);
+    }
+
+    // The dictionary is a virtual prefix: matches may point back into it
+    std::string buffer;
+    buffer.reserve(dictionary.size() + input.size());
+    buffer.append(dictionary);
+    buffer.append(input);
+
+    const char* base = buffer.data();
+    const size_t start = dictionary.size();
+    const size_t end = buffer.size();
+
+    std::string out;
+    out.reserve(input.size() + input.size() / 255 + 16);
+
+    if (input.size() < kMatchFindLimit + 1) {
+        writeLastLiterals(out, base + start, input.size());
+        return out;
+    }
+
+    // Positions are stored +1 so that 0 means empty
+    std::vector<uint32_t> table(size_t(1) << kHashLog, 0);
+    for (size_t p = 0; p + kMinMatch <= start; ++p) {
+        table[hash(read32(base + p))] = static_cast<uint32_t>(p + 1);
+    }
+
+    const size_t matchFindLimit = end - kMatchFindLimit;
+    const size_t matchEndLimit = end - kLastLiterals;
+    size_t anchor = start;
+    size_t p = start;
+
+    while (p < matchFindLimit) {
+        uint32_t sequence = read32(base + p);
+        uint32_t& slot = table[hash(sequence)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(p + 1);
+
+        if (candidate == 0 || p - (candidate - 1) > kMaxOffset || read32(base + candidate - 1) != sequence) {
+            ++p;
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t length = kMinMatch;
+        while (p + length < matchEndLimit && base[match + length] == base[p + length]) {
+            ++length;
+        }
+
+        writeSequence(out, base + anchor, p - anchor, p - match, length);
+        p += length;
+        anchor = p;
+    }
+
+    writeLastLiterals(out, base + anchor, end - anchor);
+    return out;
+}
+
+std::string Lz4::decompress(std::string_view block, size_t originalSize, std::string_view dictionary) {
+    if (dictionary.size() > kMaxOffset) {
+        dictionary = dictionary.substr(dictionary.size() - kMaxOffset);
+    }
+
+    // originalSize comes from the value's header: never size a buffer by more
+    // than the block could possibly expand to
+    if (originalSize / kMaxExpansion > block.size()) {
+        throw std::runtime_error("LZ4 original size exceeds what the block can hold");
+    }
+
+    std::string out;
+    out.reserve(dictionary.size() + originalSize);
+    out.append(dictionary);
+    const size_t limit = dictionary.size() + originalSize;
+
+    size_t pos = 0;
+    while (pos < block.size()) {
+        uint8_t token = static_cast<uint8_t>(block[pos++]);
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            literalLength += readLength(block, pos);
+        }
+        if (literalLength > block.size() - pos || out.size() + literalLength > limit) {
+            throw std::runtime_error("LZ4 literals out of bounds");
+        }
+        out.append(block.data() + pos, literalLength);
+        pos += literalLength;
+
+        // The last sequence carries literals only
+        if (pos == block.size()) {
+            break;
+        }
+
+        if (block.size() - pos < 2) {
+            throw std::runtime_error("LZ4 block truncated");
+        }
+        size_t offset = static_cast<uint8_t>(block[pos]) | (static_cast<uint8_t>(block[pos + 1]) << 8);
+        pos += 2;
+
+        size_t matchLength = token & 0x0f;
+        if (matchLength == 15) {
+            matchLength += readLength(block, pos);
+        }
+        matchLength += kMinMatch;
+
+        if (offset == 0 || offset > out.size() || out.size() + matchLength > limit) {
+            throw std::runtime_error("LZ4 match out of bounds");
+        }
+
+        size_t from = out.size() - offset;
+        if (offset >= matchLength) {
+            out.append(out, from, matchLength);
+        } else {
+            // Overlapping match, e.g. a run of one repeated byte
+            for (size_t i = 0; i < matchLength; ++i) {
+                out.push_back(out[from + i]);
+            }
+        }
+    }
+
+    if (out.size() != limit) {
+        throw std::runtime_error("LZ4 decompressed size mismatch");
+    }
+
+    out.erase(0, dictionary.size());
+    return out;
+}
+
+} // namespace tempdb
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace tempdb {
+
+/**
+ * @brief LZ4 block format compressor and decompressor
+ *
+ * A small self-contained implementation of the LZ4 block format (greedy
+ * matching, 64 KiB window). An optional dictionary acts as a virtual prefix of
+ * the input, so short values can reference content that never goes over the
+ * wire; both sides must use the same dictionary.
+ */
+class Lz4 {
+public:
+    /**
+     * @brief Compresses a buffer into a single LZ4 block
+     * @param input Bytes to compress
+     * @param dictionary Shared dictionary, only its last 64 KiB are used
+     * @return Compressed block
+     */
+    static std::string compress(std::string_view input, std::string_view dictionary = {});
+
+    /**
+     * @brief Decompresses a single LZ4 block
+     * @param block Compressed block
+     * @param originalSize Exact size of the decompressed data
+     * @param dictionary Dictionary the block was compressed with
+     * @return Decompressed bytes
+     * @throws std::runtime_error if the block is malformed or originalSize is more than it can expand to
+     */
+    static std::string decompress(std::string_view block, size_t originalSize, std::string_view dictionary = {});
+};
+
+} // namespace tempdb
@@ -0,0 +1,179 @@
+#include "Metrics.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        // Renders the label set of one sample, with an extra pair such as quantile="0.99"
+        std::string labelSet(const std::string& labels, const std::string& extra = "") {
+            if (labels.empty() && extra.empty()) {
+                return "";
+            }
+            if (labels.empty() || extra.empty()) {
+                return "{" + labels + extra + "}";
+            }
+            return "{" + labels + "," + extra + "}";
+        }
+
+        const char* typeName(int type) {
+            static const char* const names[] = {"counter", "gauge", "summary"};
+            return names[type];
+        }
+
+    } // namespace
+
+    uint64_t Metrics::Counter::value() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    int64_t Metrics::Gauge::value() const {
+        int64_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void Metrics::Distribution::record(uint64_t nanos) {
+        auto& shard = shards_[shardIndex()];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.histogram.record(nanos);
+    }
+
+    Histogram Metrics::Distribution::snapshot() const {
+        Histogram merged;
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            merged.merge(shard.histogram);
+        }
+        return merged;
+    }
+
+    Metrics& Metrics::instance() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    size_t Metrics::shardIndex() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local size_t index = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+        return index;
+    }
+
+    Metrics::Family& Metrics::family(const std::string& name, const std::string& help, Type type) {
+        auto it = families_.find(name);
+        if (it == families_.end()) {
+            it = families_.emplace(name, Family{type, help, {}, {}, {}}).first;
+        } else if (it->second.type != type) {
+            throw std::runtime_error("Metric '" + name + "' registered with two different types");
+        }
+        return it->second;
+    }
+
+    Metrics::Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = family(name, help, Type::COUNTER).counters[labels];
+        if (!slot) {
+            slot = std::make_unique<Counter>();
+        }
+        return *slot;
+    }
+
+    Metrics::Gauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = family(name, help, Type::GAUGE).gauges[labels];
+        if (!slot) {
+            slot = std::make_unique<Gauge>();
+        }
+        return *slot;
+    }
+
+    Metrics::Distribution& Metrics::distribution(const std::string& name, const std::string& help,
+                                                 const std::string& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = family(name, help, Type::SUMMARY).distributions[labels];
+        if (!slot) {
+            slot = std::make_unique<Distribution>();
+        }
+        return *slot;
+    }
+
+    std::string Metrics::label(const std::string& key, const std::string& value) {
+        std::string out = key + "=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    void Metrics::write(std::ostream& out) const {
+        static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [name, family] : families_) {
+            out << "# HELP " << name << " " << family.help << "\n";
+            out << "# TYPE " << name << " " << typeName(static_cast<int>(family.type)) << "\n";
+
+            for (const auto& [labels, counter] : family.counters) {
+                out << name << labelSet(labels) << " " << counter->value() << "\n";
+            }
+            for (const auto& [labels, gauge] : family.gauges) {
+                out << name << labelSet(labels) << " " << gauge->value() << "\n";
+            }
+            for (const auto& [labels, distribution] : family.distributions) {
+                Histogram histogram = distribution->snapshot();
+                for (double quantile : kQuantiles) {
+                    std::ostringstream q;
+                    q << "quantile=\"" << quantile << "\"";
+                    out << name << labelSet(labels, q.str()) << " "
+                        << histogram.valueAtPercentile(quantile * 100) / 1e9 << "\n";
+                }
+                out << name << "_sum" << labelSet(labels) << " " << histogram.mean() * histogram.count() / 1e9 << "\n";
+                out << name << "_count" << labelSet(labels) << " " << histogram.count() << "\n";
+            }
+        }
+    }
+
+    void Metrics::writeToFile(const std::string& path) const {
+        // Written aside and renamed over the file, so a collector never reads half of it
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::trunc);
+            if (!out) {
+                throw std::runtime_error("Error: Could not open metrics file: " + tempPath);
+            }
+            write(out);
+            out.close();
+            if (!out) {
+                throw std::runtime_error("Error: Failed to write metrics file: " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            throw std::runtime_error("Error: Failed to replace metrics file: " + path);
+        }
+    }
+
+    void Metrics::exportTo(const std::function<void(const std::string&)>& sink) const {
+        std::ostringstream out;
+        write(out);
+        sink(out.str());
+    }
+
+} // namespace tempdb
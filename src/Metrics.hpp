@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "Histogram.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Process-wide registry of client counters, gauges and latency distributions
+    *
+    * Every metric is sharded: each thread updates its own cache-line-sized slot
+    * and readers sum the slots, so hot paths never contend on a shared counter.
+    * Metrics are created on first use and live as long as the process, so the
+    * returned references can be kept. The registry renders in the Prometheus
+    * text exposition format.
+    */
+    class Metrics {
+    public:
+        static constexpr size_t kShards = 16;   ///< Slots per metric, threads are spread over them
+
+        /**
+        * @brief Monotonic counter
+        */
+        class Counter {
+        public:
+            void add(uint64_t amount = 1) {
+                shards_[shardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+            }
+            uint64_t value() const;
+
+        private:
+            struct alignas(64) Shard {
+                std::atomic<uint64_t> value{0};
+            };
+            std::array<Shard, kShards> shards_;
+        };
+
+        /**
+        * @brief Value that goes up and down, e.g. requests in flight
+        */
+        class Gauge {
+        public:
+            void add(int64_t amount = 1) {
+                shards_[shardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+            }
+            void sub(int64_t amount = 1) { add(-amount); }
+            int64_t value() const;
+
+        private:
+            struct alignas(64) Shard {
+                std::atomic<int64_t> value{0};
+            };
+            std::array<Shard, kShards> shards_;
+        };
+
+        /**
+        * @brief Latency distribution, recorded in nanoseconds and exported in seconds
+        */
+        class Distribution {
+        public:
+            void record(uint64_t nanos);
+
+            /**
+            * @brief Merge every shard into one histogram
+            */
+            Histogram snapshot() const;
+
+        private:
+            struct alignas(64) Shard {
+                mutable std::mutex mutex;   ///< Only contended when threads share a slot
+                Histogram histogram;
+            };
+            std::array<Shard, kShards> shards_;
+        };
+
+        /**
+        * @brief The process-wide registry
+        */
+        static Metrics& instance();
+
+        /**
+        * @brief Find or create a counter
+        * @param name Metric name, e.g. "tempdb_requests_total"
+        * @param help One-line description
+        * @param labels Rendered label pairs from label(), empty for none
+        */
+        Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+
+        /**
+        * @brief Find or create a gauge
+        */
+        Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+
+        /**
+        * @brief Find or create a latency distribution, exported as a summary
+        */
+        Distribution& distribution(const std::string& name, const std::string& help, const std::string& labels = "");
+
+        /**
+        * @brief Render one label pair, escaping the value
+        * @return e.g. command="GET"
+        */
+        static std::string label(const std::string& key, const std::string& value);
+
+        /**
+        * @brief Write every metric in Prometheus text format
+        */
+        void write(std::ostream& out) const;
+
+        /**
+        * @brief Write every metric to a file, replacing it atomically
+        * @throws std::runtime_error if the file cannot be written
+        */
+        void writeToFile(const std::string& path) const;
+
+        /**
+        * @brief Hand the rendered metrics to a callback, e.g. an HTTP handler or a push client
+        */
+        void exportTo(const std::function<void(const std::string&)>& sink) const;
+
+    private:
+        enum class Type { COUNTER, GAUGE, SUMMARY };
+
+        /**
+        * @brief All metrics sharing a name, keyed by their labels
+        */
+        struct Family {
+            Type type;
+            std::string help;
+            std::map<std::string, std::unique_ptr<Counter>> counters;
+            std::map<std::string, std::unique_ptr<Gauge>> gauges;
+            std::map<std::string, std::unique_ptr<Distribution>> distributions;
+        };
+
+        Metrics() = default;
+
+        Family& family(const std::string& name, const std::string& help, Type type);
+
+        /**
+        * @brief Slot of the calling thread
+        */
+        static size_t shardIndex();
+
+        mutable std::mutex mutex_;              ///< Guards families_ (lookups only, never updates)
+        std::map<std::string, Family> families_; ///< Metrics by name
+    };
+
+} // namespace tempdb
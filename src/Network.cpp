@@ -1,24 +1,158 @@
 #include "Network.hpp"
+#include "RespProtocol.hpp"
+#include "Metrics.hpp"
 
 #include <iostream>
+#include <cerrno>
 #include <cstring>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
 
 namespace tempdb {
 
-    Network::Network(const std::string& host, int port)
-        : host_(host), port_(port), sock_(-1), connected_(false) {
+    namespace {
+
+        bool setIntOption(int sock, int level, int option, int value) {
+            return setsockopt(sock, level, option, &value, sizeof(value)) == 0;
+        }
+
+        /**
+         * @brief Connection metrics shared by every Network
+         */
+        struct NetworkMetrics {
+            Metrics::Counter& bytesSent;
+            Metrics::Counter& bytesReceived;
+            Metrics::Counter& connects;
+            Metrics::Counter& connectErrors;
+            Metrics::Counter& connectionErrors;
+            Metrics::Counter& timeouts;
+        };
+
+        const NetworkMetrics& metrics() {
+            static const char* const errorsHelp = "Failed requests and connections, by error type";
+            static NetworkMetrics networkMetrics = {
+                Metrics::instance().counter("tempdb_bytes_sent_total", "Bytes written to server sockets"),
+                Metrics::instance().counter("tempdb_bytes_received_total", "Bytes read from server sockets"),
+                Metrics::instance().counter("tempdb_connects_total", "Connections established"),
+                Metrics::instance().counter("tempdb_errors_total", errorsHelp, Metrics::label("type", "connect")),
+                Metrics::instance().counter("tempdb_errors_total", errorsHelp, Metrics::label("type", "connection")),
+                Metrics::instance().counter("tempdb_errors_total", errorsHelp, Metrics::label("type", "timeout")),
+            };
+            return networkMetrics;
+        }
+
+        /**
+         * @brief recv() that also returns the kernel receive timestamp, converted to the monotonic clock
+         * @param kernelTime Set when the kernel attached a software timestamp, left alone otherwise
+         */
+        ssize_t receiveTimestamped(int sock, char* buffer, size_t size,
+                                   std::chrono::steady_clock::time_point& kernelTime) {
+            iovec data = {buffer, size};
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+            msghdr message = {};
+            message.msg_iov = &data;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+
+            ssize_t received = recvmsg(sock, &message, MSG_DONTWAIT);
+            if (received <= 0) {
+                return received;
+            }
+
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+                if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_TIMESTAMPING) {
+                    continue;
+                }
+                scm_timestamping stamps;
+                std::memcpy(&stamps, CMSG_DATA(header), sizeof(stamps));
+                if (stamps.ts[0].tv_sec == 0 && stamps.ts[0].tv_nsec == 0) {
+                    break;
+                }
+
+                // Software timestamps are wall-clock; shift by how long ago they were taken
+                auto stamped = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::seconds(stamps.ts[0].tv_sec) + std::chrono::nanoseconds(stamps.ts[0].tv_nsec)));
+                auto age = std::chrono::system_clock::now() - stamped;
+                kernelTime = std::chrono::steady_clock::now() -
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+                break;
+            }
+            return received;
+        }
+
+        int getIntOption(int sock, int level, int option) {
+            int value = -1;
+            socklen_t length = sizeof(value);
+            if (getsockopt(sock, level, option, &value, &length) < 0) {
+                return -1;
+            }
+            return value;
+        }
+
+    } // namespace
+
+    ConnectionProfile ConnectionProfile::lowLatency() {
+        ConnectionProfile profile;
+        profile.name = "low-latency";
+        profile.noDelay = true;
+        profile.quickAck = true;
+        profile.busyPollMicros = 50;
+        profile.keepAlive = true;
+        profile.keepAliveIdleSeconds = 30;
+        profile.keepAliveIntervalSeconds = 5;
+        profile.keepAliveProbes = 3;
+        profile.userTimeoutMillis = 10000;
+        return profile;
+    }
+
+    ConnectionProfile ConnectionProfile::throughput() {
+        ConnectionProfile profile;
+        profile.name = "throughput";
+        profile.sendBufferBytes = 4 * 1024 * 1024;
+        profile.receiveBufferBytes = 4 * 1024 * 1024;
+        profile.keepAlive = true;
+        profile.keepAliveIdleSeconds = 60;
+        profile.keepAliveIntervalSeconds = 10;
+        profile.keepAliveProbes = 6;
+        profile.userTimeoutMillis = 30000;
+        return profile;
+    }
+
+    ConnectionProfile ConnectionProfile::fromName(const std::string& name) {
+        if (name == "default") {
+            return ConnectionProfile();
+        }
+        if (name == "low-latency") {
+            return lowLatency();
+        }
+        if (name == "throughput") {
+            return throughput();
+        }
+        throw std::invalid_argument("Unknown connection profile '" + name + "'. Expected low-latency, throughput or default");
+    }
+
+    Network::Network(const std::string& host, int port, const ConnectionProfile& profile, Deadline connectDeadline)
+        : host_(host), port_(port), profile_(profile), sock_(-1), connected_(false) {
 
         if (port <= 0 || port > 65535) {
             throw std::runtime_error("Invalid port number: " + std::to_string(port));
         }
 
-        std::cout << "Resolving hostname..." << std::endl;
+        if (verbose()) {
+            std::cout << "Resolving hostname..." << std::endl;
+        }
         std::string port_str = std::to_string(port_);
 
         // Resolve the hostname or IP address
@@ -28,11 +162,12 @@ namespace tempdb {
         hints.ai_socktype = SOCK_STREAM; // TCP
 
         if (getaddrinfo(host_.c_str(), port_str.c_str(), &hints, &res) != 0) {
+            metrics().connectErrors.add();
             throw std::runtime_error("Error: Could not resolve hostname: " + host_);
         }
 
         //Print the resolved address
-        for (struct addrinfo* p = res; p != nullptr; p = p->ai_next) {
+        for (struct addrinfo* p = res; verbose() && p != nullptr; p = p->ai_next) {
             // Print details about each address
             std::cout << "Address Family: " << p->ai_family << std::endl;
             std::cout << "Socket Type: " << p->ai_socktype << std::endl;
@@ -41,10 +176,14 @@ namespace tempdb {
         }
 
         try {
-            createSocket(res);
+            createSocket(res, connectDeadline);
             freeaddrinfo(res);
             connected_ = true;
-            std::cout << "Connected to " << host_ << ":" << port_ << " successfully!" << std::endl;
+            metrics().connects.add();
+            if (verbose()) {
+                std::cout << "Connected to " << host_ << ":" << port_ << " successfully!" << std::endl;
+                std::cout << "Socket options (" << profile_.name << "): " << describeSocketOptions() << std::endl;
+            }
         } catch (...) {
             freeaddrinfo(res);
             throw;
@@ -57,35 +196,177 @@ namespace tempdb {
         }
     }
 
-    void Network::createSocket(addrinfo* addr) {
-        std::cout << "Creating socket..." << std::endl;
+    std::vector<std::unique_ptr<Network>> Network::connectAll(const std::vector<std::pair<std::string, int>>& servers,
+                                                              const ConnectionProfile& profile, Deadline deadline) {
+        std::vector<std::unique_ptr<Network>> networks(servers.size());
+        std::vector<std::exception_ptr> errors(servers.size());
+
+        auto connectOne = [&](size_t i) {
+            try {
+                networks[i] = std::make_unique<Network>(servers[i].first, servers[i].second, profile, deadline);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        // The first connection is made on the calling thread, so a single one costs no thread
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < servers.size(); ++i) {
+            workers.emplace_back(connectOne, i);
+        }
+        if (!servers.empty()) {
+            connectOne(0);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        static const std::string ping = "*1\r\n$4\r\nPING\r\n";
+        for (auto& network : networks) {
+            network->sendData(ping, deadline);
+        }
+        std::string reply;
+        for (size_t i = 0; i < networks.size(); ++i) {
+            networks[i]->receiveReply(reply, deadline);
+            if (!reply.empty() && reply[0] == '-') {
+                throw std::runtime_error("Error: " + servers[i].first + ":" + std::to_string(servers[i].second) +
+                                         " rejected PING: " + reply.substr(1, reply.find('\r') - 1));
+            }
+        }
+
+        return networks;
+    }
+
+    void Network::createSocket(addrinfo* addr, Deadline deadline) {
+        if (verbose()) {
+            std::cout << "Creating socket..." << std::endl;
+        }
 
         sock_ = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
         if (sock_ < 0) {
             throw std::runtime_error("Error: Could not create socket");
         }
 
-        std::cout << "Connecting to server..." << std::endl;
-        if (connect(sock_, addr->ai_addr, addr->ai_addrlen) < 0) {
+        // Buffer sizes must be set before connect to affect TCP window scaling
+        applyProfile();
+
+        // All I/O, connect included, is non-blocking and bounded by poll() against a deadline
+        int flags = fcntl(sock_, F_GETFL, 0);
+        if (flags < 0 || fcntl(sock_, F_SETFL, flags | O_NONBLOCK) < 0) {
             close(sock_);
             sock_ = -1;
-            throw std::runtime_error("Error: Connection failed");
+            throw std::runtime_error("Error: Could not make socket non-blocking");
+        }
+
+        if (verbose()) {
+            std::cout << "Connecting to server..." << std::endl;
+        }
+        if (connect(sock_, addr->ai_addr, addr->ai_addrlen) < 0) {
+            int error = errno;
+            if (error == EINPROGRESS) {
+                if (!waitFor(POLLOUT, deadline)) {
+                    close(sock_);
+                    sock_ = -1;
+                    metrics().timeouts.add();
+                    throw TimeoutError("Connection timed out");
+                }
+                socklen_t length = sizeof(error);
+                getsockopt(sock_, SOL_SOCKET, SO_ERROR, &error, &length);
+            }
+
+            if (error != 0) {
+                close(sock_);
+                sock_ = -1;
+                metrics().connectErrors.add();
+                throw std::runtime_error("Error: Connection failed");
+            }
         }
     }
 
 
-    ssize_t Network::sendData(const std::string& data) {
+    void Network::applyProfile() {
+        struct Option {
+            const char* name;
+            int level;
+            int option;
+            int value;
+            bool enabled;
+        };
+
+        const Option options[] = {
+            {"TCP_NODELAY", IPPROTO_TCP, TCP_NODELAY, 1, profile_.noDelay},
+            {"TCP_QUICKACK", IPPROTO_TCP, TCP_QUICKACK, 1, profile_.quickAck},
+            {"SO_BUSY_POLL", SOL_SOCKET, SO_BUSY_POLL, profile_.busyPollMicros, profile_.busyPollMicros > 0},
+            {"SO_SNDBUF", SOL_SOCKET, SO_SNDBUF, profile_.sendBufferBytes, profile_.sendBufferBytes > 0},
+            {"SO_RCVBUF", SOL_SOCKET, SO_RCVBUF, profile_.receiveBufferBytes, profile_.receiveBufferBytes > 0},
+            {"SO_KEEPALIVE", SOL_SOCKET, SO_KEEPALIVE, 1, profile_.keepAlive},
+            {"TCP_KEEPIDLE", IPPROTO_TCP, TCP_KEEPIDLE, profile_.keepAliveIdleSeconds, profile_.keepAliveIdleSeconds > 0},
+            {"TCP_KEEPINTVL", IPPROTO_TCP, TCP_KEEPINTVL, profile_.keepAliveIntervalSeconds, profile_.keepAliveIntervalSeconds > 0},
+            {"TCP_KEEPCNT", IPPROTO_TCP, TCP_KEEPCNT, profile_.keepAliveProbes, profile_.keepAliveProbes > 0},
+            {"TCP_USER_TIMEOUT", IPPROTO_TCP, TCP_USER_TIMEOUT, profile_.userTimeoutMillis, profile_.userTimeoutMillis > 0},
+        };
+
+        // Options are best effort: SO_BUSY_POLL, for one, needs CAP_NET_ADMIN above the sysctl default
+        for (const auto& option : options) {
+            if (option.enabled && !setIntOption(sock_, option.level, option.option, option.value)) {
+                std::cerr << "Warning: Could not set " << option.name << ": " << std::strerror(errno) << std::endl;
+            }
+        }
+    }
+
+    std::string Network::describeSocketOptions() const {
+        std::ostringstream oss;
+        oss << "TCP_NODELAY=" << getIntOption(sock_, IPPROTO_TCP, TCP_NODELAY)
+            << " TCP_QUICKACK=" << getIntOption(sock_, IPPROTO_TCP, TCP_QUICKACK)
+            << " SO_BUSY_POLL=" << getIntOption(sock_, SOL_SOCKET, SO_BUSY_POLL)
+            << " SO_SNDBUF=" << getIntOption(sock_, SOL_SOCKET, SO_SNDBUF)
+            << " SO_RCVBUF=" << getIntOption(sock_, SOL_SOCKET, SO_RCVBUF)
+            << " SO_KEEPALIVE=" << getIntOption(sock_, SOL_SOCKET, SO_KEEPALIVE)
+            << " TCP_KEEPIDLE=" << getIntOption(sock_, IPPROTO_TCP, TCP_KEEPIDLE)
+            << " TCP_KEEPINTVL=" << getIntOption(sock_, IPPROTO_TCP, TCP_KEEPINTVL)
+            << " TCP_KEEPCNT=" << getIntOption(sock_, IPPROTO_TCP, TCP_KEEPCNT)
+            << " TCP_USER_TIMEOUT=" << getIntOption(sock_, IPPROTO_TCP, TCP_USER_TIMEOUT);
+        return oss.str();
+    }
+
+    ssize_t Network::sendData(const std::string& data, Deadline deadline, bool skipLateReply) {
         if (!connected_) {
             throw std::runtime_error("Not connected to server");
         }
 
-        ssize_t sent_bytes = send(sock_, data.c_str(), data.size(), 0);
-        if (sent_bytes < 0) {
-            connected_ = false;
-            throw std::runtime_error("Error: Connection lost while sending data");
+        // Finish a request an earlier deadline cut short, so the server only ever sees whole commands
+        if (!outbox_.empty()) {
+            outbox_.erase(0, writeUntil(outbox_.data(), outbox_.size(), deadline));
+            if (!outbox_.empty()) {
+                metrics().timeouts.add();
+                throw TimeoutError("Request timed out behind an earlier unsent request");
+            }
         }
 
-        return sent_bytes;
+        if (timestamps_) {
+            wireTimes_.firstByteWritten = {};
+        }
+        size_t total = writeUntil(data.data(), data.size(), deadline);
+        if (total < data.size()) {
+            metrics().timeouts.add();
+
+            // A partly written request must still be completed and its reply skipped
+            if (total > 0) {
+                outbox_.assign(data, total, std::string::npos);
+                if (skipLateReply) {
+                    discardNextReply();
+                }
+                throw PartialSendError("Request timed out while sending");
+            }
+            throw TimeoutError("Request timed out while sending");
+        }
+
+        return total;
     }
 
     int Network::receiveData(char* buffer, size_t bufferSize) {
@@ -94,19 +375,213 @@ namespace tempdb {
             throw std::runtime_error("Not connected to server");
         }
 
-        int bytes_received = recv(sock_, buffer, bufferSize - 1, 0);
-        //int bytes_received = recv(sock_, buffer, sizeof(buffer) - 1, 0);
+        int bytes_received;
+        while ((bytes_received = recv(sock_, buffer, bufferSize - 1, MSG_DONTWAIT)) < 0 &&
+               (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            waitFor(POLLIN, kNoDeadline);
+        }
+
         if (bytes_received < 0) {
-            connected_ = false;
+            markDisconnected();
             throw std::runtime_error("Error: Failed to receive data from server");
         } else if (bytes_received == 0) {
-            connected_ = false;
+            markDisconnected();
             std::cerr << "Error: Server closed the connection" << std::endl;
             return 0; // Server closed connection
         }
 
+        // The kernel drops out of quick-ACK mode on its own, so re-arm it after every read
+        if (profile_.quickAck) {
+            setIntOption(sock_, IPPROTO_TCP, TCP_QUICKACK, 1);
+        }
+
+        metrics().bytesReceived.add(bytes_received);
         buffer[bytes_received] = '\0'; // Null-terminate
         return bytes_received;
     }
 
+    std::string Network::receiveReply(Deadline deadline) {
+        std::string reply;
+        receiveReply(reply, deadline);
+        return reply;
+    }
+
+    void Network::receiveReply(std::string& reply, Deadline deadline) {
+        while (!extractReply(reply)) {
+            if (!fillPending(deadline)) {
+                // The reply will still arrive, skip it then so the connection stays in sync
+                discardNextReply();
+                metrics().timeouts.add();
+                throw TimeoutError("Request timed out waiting for the reply");
+            }
+        }
+    }
+
+    bool Network::tryReceiveReply(std::string& reply) {
+        while (!extractReply(reply)) {
+            if (!fillPending(Deadline::min())) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Network::waitReadable(Deadline deadline) {
+        return framer_.measure(pending_) != 0 || waitFor(POLLIN, deadline);
+    }
+
+    bool Network::waitFor(short events, Deadline deadline) {
+        while (true) {
+            timespec timeout = {0, 0};
+            timespec* timeoutPtr = nullptr;
+
+            if (deadline != kNoDeadline) {
+                // Compare before subtracting: Deadline::min() means "do not wait" and would overflow
+                auto now = std::chrono::steady_clock::now();
+                if (deadline <= now) {
+                    return false;
+                }
+                auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+                timeout.tv_sec = static_cast<time_t>(nanos / 1000000000);
+                timeout.tv_nsec = static_cast<long>(nanos % 1000000000);
+                timeoutPtr = &timeout;
+            }
+
+            pollfd fd = {sock_, events, 0};
+            int ready = ppoll(&fd, 1, timeoutPtr, nullptr);
+            if (ready > 0) {
+                return true;
+            }
+            if (ready < 0 && errno != EINTR) {
+                markDisconnected();
+                throw std::runtime_error("Error: Failed to wait for the connection");
+            }
+        }
+    }
+
+    size_t Network::sendAvailable(const char* data, size_t size) {
+        if (!connected_) {
+            throw std::runtime_error("Not connected to server");
+        }
+        return writeUntil(data, size, Deadline::min());
+    }
+
+    size_t Network::writeUntil(const char* data, size_t size, Deadline deadline) {
+        // send() may accept only part of a large batch, keep going until it is all written
+        size_t total = 0;
+        while (total < size) {
+            // Stamped before the call: on loopback send() can run the server's reply before returning
+            std::chrono::steady_clock::time_point sendingAt{};
+            if (timestamps_) {
+                sendingAt = std::chrono::steady_clock::now();
+            }
+            ssize_t sent_bytes = send(sock_, data + total, size - total, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent_bytes >= 0) {
+                if (sent_bytes > 0 && wireTimes_.firstByteWritten == std::chrono::steady_clock::time_point()) {
+                    wireTimes_.firstByteWritten = sendingAt;
+                }
+                metrics().bytesSent.add(sent_bytes);
+                total += sent_bytes;
+                continue;
+            }
+
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                markDisconnected();
+                throw std::runtime_error("Error: Connection lost while sending data");
+            }
+            if (!waitFor(POLLOUT, deadline)) {
+                break;
+            }
+        }
+
+        return total;
+    }
+
+    bool Network::fillPending(Deadline deadline) {
+        const size_t bufferSize = 4096;
+        char buffer[bufferSize];
+
+        while (true) {
+            if (!connected_) {
+                throw std::runtime_error("Not connected to server");
+            }
+
+            std::chrono::steady_clock::time_point kernelTime{};
+            ssize_t bytesReceived = kernelTimestamps_ ? receiveTimestamped(sock_, buffer, bufferSize, kernelTime)
+                                                      : recv(sock_, buffer, bufferSize, MSG_DONTWAIT);
+            if (bytesReceived > 0) {
+                // Bytes left in pending_ arrived earlier and keep their timestamps
+                if (timestamps_ && pending_.empty()) {
+                    pendingSince_ = std::chrono::steady_clock::now();
+                    pendingKernelSince_ = kernelTime;
+                }
+                metrics().bytesReceived.add(bytesReceived);
+                if (profile_.quickAck) {
+                    setIntOption(sock_, IPPROTO_TCP, TCP_QUICKACK, 1);
+                }
+                pending_.append(buffer, bytesReceived);
+                return true;
+            }
+
+            if (bytesReceived == 0) {
+                markDisconnected();
+                throw std::runtime_error("Error: Server closed the connection");
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                markDisconnected();
+                throw std::runtime_error("Error: Failed to receive data from server");
+            }
+            if (!waitFor(POLLIN, deadline)) {
+                return false;
+            }
+        }
+    }
+
+    void Network::enableTimestamps() {
+        timestamps_ = true;
+
+        // Best effort: the software receive timestamp is widely supported but not everywhere
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        kernelTimestamps_ = setIntOption(sock_, SOL_SOCKET, SO_TIMESTAMPING, flags);
+    }
+
+    void Network::markDisconnected() {
+        if (connected_.exchange(false)) {
+            metrics().connectionErrors.add();
+        }
+    }
+
+    void Network::discardNextReply() {
+        ++owedReplies_;
+    }
+
+    bool Network::extractReply(std::string& reply) {
+        size_t replyLength;
+        while ((replyLength = framer_.measure(pending_)) != 0) {
+            framer_.reset();
+            if (owedReplies_ > 0) {
+                // Reply to a request nobody is waiting for any more
+                pending_.erase(0, replyLength);
+                --owedReplies_;
+                continue;
+            }
+
+            reply.assign(pending_, 0, replyLength);
+            pending_.erase(0, replyLength);
+            if (timestamps_) {
+                wireTimes_.firstReplyByte = pendingSince_;
+                wireTimes_.kernelReceived = pendingKernelSince_;
+            }
+            return true;
+        }
+        return false;
+    }
+
 } // namespace tempdb
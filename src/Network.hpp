@@ -1,13 +1,97 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "RespProtocol.hpp"
 
 struct addrinfo;
 
 namespace tempdb {
 
+    /**
+    * @brief Point in time by which a request must complete
+    */
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    /**
+    * @brief Deadline that never expires
+    */
+    constexpr Deadline kNoDeadline = Deadline::max();
+
+    /**
+    * @brief Thrown when a request misses its deadline
+    *
+    * The connection stays usable: the late reply is skipped when it arrives.
+    */
+    class TimeoutError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+    * @brief TimeoutError for a request whose deadline expired after part of it was written
+    *
+    * The rest goes out ahead of the next request, so the server still replies to it.
+    */
+    class PartialSendError : public TimeoutError {
+    public:
+        using TimeoutError::TimeoutError;
+    };
+
+    /**
+    * @brief Socket tuning applied before the connection is established
+    *
+    * Zero values keep the kernel default for that option.
+    */
+    struct ConnectionProfile {
+        std::string name = "default";   ///< Profile name shown in reports
+        bool noDelay = false;           ///< TCP_NODELAY, disables Nagle's algorithm
+        bool quickAck = false;          ///< TCP_QUICKACK, re-armed after every read
+        int busyPollMicros = 0;         ///< SO_BUSY_POLL budget in microseconds
+        int sendBufferBytes = 0;        ///< SO_SNDBUF
+        int receiveBufferBytes = 0;     ///< SO_RCVBUF
+        bool keepAlive = false;         ///< SO_KEEPALIVE
+        int keepAliveIdleSeconds = 0;   ///< TCP_KEEPIDLE
+        int keepAliveIntervalSeconds = 0; ///< TCP_KEEPINTVL
+        int keepAliveProbes = 0;        ///< TCP_KEEPCNT
+        int userTimeoutMillis = 0;      ///< TCP_USER_TIMEOUT
+        bool quiet = false;             ///< No connect diagnostics, even with setVerbose(true)
+
+        /**
+        * @brief Small requests on a fast link: no Nagle, immediate ACKs, busy polling
+        */
+        static ConnectionProfile lowLatency();
+
+        /**
+        * @brief Bulk transfers and deep pipelines: large socket buffers
+        */
+        static ConnectionProfile throughput();
+
+        /**
+        * @brief Look up a profile by name
+        * @param name "default", "low-latency" or "throughput"
+        * @throws std::invalid_argument if the name is unknown
+        */
+        static ConnectionProfile fromName(const std::string& name);
+    };
+
+    /**
+    * @brief Wire-level timestamps of the latest request and reply, monotonic clock
+    *
+    * Zero (default-constructed) when not observed.
+    */
+    struct WireTimes {
+        std::chrono::steady_clock::time_point firstByteWritten{}; ///< The socket accepted the first request byte
+        std::chrono::steady_clock::time_point kernelReceived{};   ///< Kernel timestamp of the first reply byte
+        std::chrono::steady_clock::time_point firstReplyByte{};   ///< The first reply byte was read
+    };
+
     /**
     * @brief Network connection manager for tempDB client
     *
@@ -21,32 +105,210 @@ namespace tempdb {
         * @brief Constructor - creates socket and establishes connection
         * @param host Server hostname or IP address
         * @param port Server port number
+        * @param profile Socket tuning profile
+        * @param connectDeadline Time by which the connection must be established
+        * @throws TimeoutError if the connection is not established before the deadline
         * @throws std::runtime_error if connection fails
         */
-        explicit Network(const std::string& host, int port);
+        explicit Network(const std::string& host, int port, const ConnectionProfile& profile = ConnectionProfile(),
+                         Deadline connectDeadline = kNoDeadline);
 
         /**
         * @brief Destructor - closes socket and cleans up resources
         */
         ~Network();
 
-        ssize_t sendData(const std::string& data);
+        /**
+        * @brief Open several connections at once and check that each one answers
+        *
+        * Every connection is resolved and connected on its own thread. A PING is
+        * then written to all of them before any reply is awaited, so the whole
+        * warm-up costs about one connect plus one round trip, however many
+        * connections there are.
+        * @param servers Host and port of every connection, repeated for several connections to one server
+        * @param profile Socket tuning profile
+        * @param deadline Time by which every connection must be established and verified
+        * @return Connections in the order of servers
+        * @throws TimeoutError if the deadline passes first
+        * @throws std::runtime_error if any connection fails or answers the PING with an error
+        */
+        static std::vector<std::unique_ptr<Network>> connectAll(const std::vector<std::pair<std::string, int>>& servers,
+                                                                const ConnectionProfile& profile = ConnectionProfile(),
+                                                                Deadline deadline = kNoDeadline);
+
+        /**
+        * @brief Send all of the given bytes
+        *
+        * If the deadline expires after part of the request was written, the rest is
+        * sent ahead of the next request and its reply is skipped.
+        * @param data Bytes to send
+        * @param deadline Time by which the data must be written
+        * @param skipLateReply false when the caller pipelines and will skip the reply
+        *        to a partly written request itself, in order, with discardNextReply()
+        * @return Number of bytes sent
+        * @throws PartialSendError if the deadline expires after part of the data was written
+        * @throws TimeoutError if the deadline expires before any of it was written
+        * @throws std::runtime_error if the connection fails
+        */
+        ssize_t sendData(const std::string& data, Deadline deadline = kNoDeadline, bool skipLateReply = true);
+
+        /**
+        * @brief Write as much of the data as the socket accepts without waiting
+        *
+        * For callers that poll the socket themselves and keep their own outgoing
+        * buffer; unlike sendData() nothing is queued internally.
+        * @param data Bytes to send
+        * @param size Number of bytes
+        * @return Number of bytes written, possibly 0
+        * @throws std::runtime_error if the connection fails
+        */
+        size_t sendAvailable(const char* data, size_t size);
 
         int receiveData(char* buffer, size_t bufferSize);
 
+        /**
+        * @brief Receive exactly one complete RESP reply
+        *
+        * Bytes that arrive past the end of the reply are kept and served by the
+        * next call, so pipelined replies are never lost or merged.
+        * @param deadline Time by which the reply must be complete
+        * @return Raw RESP reply
+        * @throws TimeoutError if the deadline expires first; the late reply is skipped
+        * @throws std::runtime_error if the connection fails or is closed mid-reply
+        */
+        std::string receiveReply(Deadline deadline = kNoDeadline);
+
+        /**
+        * @brief Receive exactly one complete RESP reply into a reusable buffer
+        * @param reply Replaced by the raw RESP reply
+        * @param deadline Time by which the reply must be complete
+        * @throws TimeoutError if the deadline expires first; the late reply is skipped
+        * @throws std::runtime_error if the connection fails or is closed mid-reply
+        */
+        void receiveReply(std::string& reply, Deadline deadline = kNoDeadline);
+
+        /**
+        * @brief Receive a complete RESP reply if one is available without blocking
+        * @param reply Set to the raw reply on success
+        * @return true if a reply was received, false if none is complete yet
+        * @throws std::runtime_error if the connection fails or is closed
+        */
+        bool tryReceiveReply(std::string& reply);
+
+        /**
+        * @brief Drop the reply to the oldest request still awaiting one
+        *
+        * Used when a request has been abandoned (e.g. a hedged read won on another
+        * connection) so that later replies stay matched to their requests.
+        */
+        void discardNextReply();
+
+        /**
+        * @brief Wait until reply data is available or the deadline passes
+        * @param deadline Time to give up waiting
+        * @return true if data is available
+        */
+        bool waitReadable(Deadline deadline);
+
+        /**
+        * @brief Socket file descriptor, for polling several connections at once
+        */
+        int fd() const { return sock_; }
+
+        /**
+        * @brief Describe the socket options as reported back by the kernel
+        * @return One line listing the effective values
+        */
+        std::string describeSocketOptions() const;
+
+        /**
+        * @brief Start recording WireTimes for every request and reply
+        *
+        * Also asks the kernel for software receive timestamps (SO_TIMESTAMPING);
+        * where that is unavailable only the user-space times are recorded.
+        */
+        void enableTimestamps();
+
+        /**
+        * @brief Timestamps of the last sendData() and of the last reply received
+        */
+        const WireTimes& wireTimes() const { return wireTimes_; }
+
+        /**
+        * @brief Print connection diagnostics (resolution, connect, socket options)
+        * @param verbose false to connect silently
+        */
+        static void setVerbose(bool verbose) { verbose_ = verbose; }
+
     private:
 
+        /**
+        * @brief Whether this connection prints its connect diagnostics
+        */
+        bool verbose() const { return verbose_ && !profile_.quiet; }
+
         /**
         * @brief Create and connect socket
         * @param addr Address information for connection
+        * @param deadline Time by which the connection must be established
+        * @throws TimeoutError if the deadline passes first
         * @throws std::runtime_error if socket creation or connection fails
         */
-        void createSocket(addrinfo* addr);
+        void createSocket(addrinfo* addr, Deadline deadline);
+
+        /**
+        * @brief Apply the profile to the socket, warning about rejected options
+        */
+        void applyProfile();
+
+        /**
+        * @brief Take the next wanted reply out of the receive buffer, skipping discarded ones
+        * @param reply Set to the raw reply on success
+        * @return true if a complete wanted reply was buffered
+        */
+        bool extractReply(std::string& reply);
+
+        /**
+        * @brief Receive whatever is available into the receive buffer
+        * @param deadline Time to give up waiting for data
+        * @return false if no data arrived before the deadline
+        */
+        bool fillPending(Deadline deadline);
+
+        /**
+        * @brief Write as much as possible before the deadline
+        * @return Number of bytes written
+        */
+        size_t writeUntil(const char* data, size_t size, Deadline deadline);
+
+        /**
+        * @brief Poll the socket for the given events
+        * @return false if the deadline passed first
+        */
+        bool waitFor(short events, Deadline deadline);
+
+        /**
+        * @brief Mark the connection lost, counting the first loss only
+        */
+        void markDisconnected();
 
         std::string host_;  ///< Server hostname
         int port_;          ///< Server port
+        ConnectionProfile profile_; ///< Socket tuning profile
         int sock_;          ///< Socket file descriptor
-        bool connected_;    ///< Connection status
+        std::atomic<bool> connected_; ///< Connection status, shared by reader and writer threads
+        std::string pending_; ///< Received bytes not yet returned as a reply
+        RespProtocol::ReplyFramer framer_; ///< Progress through the reply at the front of pending_
+        std::atomic<size_t> owedReplies_{0}; ///< Replies still to arrive for abandoned requests
+        std::string outbox_;  ///< Tail of a request cut short by its deadline
+
+        bool timestamps_ = false;  ///< Record wireTimes_
+        bool kernelTimestamps_ = false; ///< SO_TIMESTAMPING is on, receive through recvmsg
+        WireTimes wireTimes_;      ///< Timestamps of the latest request and reply
+        std::chrono::steady_clock::time_point pendingSince_{};  ///< Read time of the first byte in pending_
+        std::chrono::steady_clock::time_point pendingKernelSince_{}; ///< Kernel timestamp of the same byte
+
+        static inline std::atomic<bool> verbose_{false}; ///< Print connection diagnostics
     };
 
 } // namespace tempdb
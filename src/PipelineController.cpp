@@ -0,0 +1,90 @@
+#include "PipelineController.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        // How long a base RTT estimate is trusted before it is measured again
+        const std::chrono::seconds kMinRttWindow(10);
+
+        // A slow-start doubling must raise throughput by this much to keep doubling
+        const double kSlowStartGain = 1.25;
+
+        // Checked before anything uses the limits: std::clamp needs minDepth <= maxDepth
+        const PipelineOptions& validated(const PipelineOptions& options) {
+            if (options.minDepth == 0 || options.minDepth > options.maxDepth) {
+                throw std::runtime_error("Invalid pipeline depth limits: " + std::to_string(options.minDepth) + ".." +
+                                         std::to_string(options.maxDepth));
+            }
+            return options;
+        }
+
+    } // namespace
+
+    PipelineController::PipelineController(const PipelineOptions& options)
+        : options_(validated(options)), depth_(std::clamp(options.initialDepth, options.minDepth, options.maxDepth)) {
+    }
+
+    void PipelineController::onSend(size_t inFlight) {
+        if (inFlight >= depth_) {
+            roundSaturated_ = true;
+        }
+    }
+
+    void PipelineController::onReply(Clock::duration rtt, Clock::time_point now) {
+        minRtt_ = std::min(minRtt_, rtt);
+        nextMinRtt_ = std::min(nextMinRtt_, rtt);
+        if (minRttWindowStart_ == Clock::time_point()) {
+            minRttWindowStart_ = now;
+        } else if (now - minRttWindowStart_ >= kMinRttWindow) {
+            // Forget the old base RTT, the route or the server may have changed
+            minRtt_ = nextMinRtt_;
+            nextMinRtt_ = Clock::duration::max();
+            minRttWindowStart_ = now;
+        }
+
+        // The very first reply only opens the first round, so every round spans whole reply intervals
+        if (roundStart_ == Clock::time_point()) {
+            roundStart_ = now;
+            return;
+        }
+
+        ++roundReplies_;
+        roundMinRtt_ = std::min(roundMinRtt_, rtt);
+        if (roundReplies_ >= depth_) {
+            endRound(now);
+        }
+    }
+
+    void PipelineController::endRound(Clock::time_point now) {
+        double seconds = std::chrono::duration<double>(now - roundStart_).count();
+        throughput_ = seconds > 0 ? roundReplies_ / seconds : 0;
+        auto queueDelay = roundMinRtt_ - minRtt_;
+
+        if (queueDelay > options_.targetDelay) {
+            // Three quarters, but always at least one less so small depths shrink too
+            depth_ = std::max(options_.minDepth, std::min(depth_ - 1, depth_ * 3 / 4));
+            slowStart_ = false;
+        } else if (queueDelay < options_.targetDelay / 2 && roundSaturated_) {
+            if (slowStart_ && slowStartThroughput_ > 0 && throughput_ < slowStartThroughput_ * kSlowStartGain) {
+                // The last doubling barely helped: the server, not the depth, is the bottleneck
+                slowStart_ = false;
+            }
+            if (slowStart_) {
+                slowStartThroughput_ = throughput_;
+                depth_ = std::min(options_.maxDepth, depth_ * 2);
+            } else {
+                depth_ = std::min(options_.maxDepth, depth_ + 1);
+            }
+        }
+
+        roundStart_ = now;
+        roundReplies_ = 0;
+        roundMinRtt_ = Clock::duration::max();
+        roundSaturated_ = false;
+    }
+
+} // namespace tempdb
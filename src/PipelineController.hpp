@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace tempdb {
+
+    /**
+    * @brief Limits for a PipelineController
+    *
+    * Setting minDepth equal to maxDepth pins the depth to that value.
+    */
+    struct PipelineOptions {
+        std::chrono::microseconds targetDelay{1000};    ///< Queueing delay (RTT above the minimum) to stay under
+        size_t initialDepth = 8;                        ///< Depth before the first measurement
+        size_t minDepth = 1;                            ///< Never pipeline fewer requests
+        size_t maxDepth = 1024;                         ///< Never pipeline more requests
+    };
+
+    /**
+    * @brief Congestion-control style limit on the requests in flight on one connection
+    *
+    * A delay-based AIMD loop in the spirit of TCP Vegas. The lowest RTT seen
+    * is the path's base RTT; anything above it is queueing, in the client, the
+    * network or the server. Once per round (one depth's worth of replies) the
+    * controller looks at the round's throughput and standing queueing delay:
+    * the round's lowest RTT minus the base RTT. Jitter only ever adds delay,
+    * so the minimum keeps it from passing for a queue.
+    *
+    * - delay above the target: multiplicative decrease to three quarters,
+    *   and by at least one
+    * - delay below half the target and the depth was used: increase,
+    *   doubling per round (slow start) until the first decrease or until a
+    *   doubling stops buying throughput, then one request per round
+    * - otherwise: hold
+    *
+    * A depth the caller never reaches is not grown, and the base RTT is
+    * re-measured every 10 seconds so a changed path is picked up. Not
+    * thread-safe: the owner of the connection drives it.
+    */
+    class PipelineController {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+        * @brief Constructor
+        * @param options Depth limits, initialDepth is clamped into them
+        * @throws std::runtime_error if minDepth is 0 or above maxDepth
+        */
+        explicit PipelineController(const PipelineOptions& options = PipelineOptions());
+
+        /**
+        * @brief Requests that may be in flight now
+        */
+        size_t depth() const { return depth_; }
+
+        /**
+        * @brief Note the number of requests in flight after a send, to tell whether the depth is used
+        */
+        void onSend(size_t inFlight);
+
+        /**
+        * @brief Feed one reply
+        * @param rtt Time from the request's last byte written to its reply
+        * @param now Arrival time of the reply
+        */
+        void onReply(Clock::duration rtt, Clock::time_point now);
+
+        /**
+        * @brief Lowest RTT of the current measurement window, zero before the first reply
+        */
+        Clock::duration minRtt() const { return minRtt_ == Clock::duration::max() ? Clock::duration::zero() : minRtt_; }
+
+        /**
+        * @brief Replies per second over the last completed round
+        */
+        double throughput() const { return throughput_; }
+
+    private:
+        /**
+        * @brief Adjust the depth from the round that just ended
+        */
+        void endRound(Clock::time_point now);
+
+        PipelineOptions options_;
+        size_t depth_;                          ///< Current limit
+        bool slowStart_ = true;                 ///< Doubling until the first decrease
+
+        Clock::duration minRtt_ = Clock::duration::max();   ///< Base RTT estimate
+        Clock::duration nextMinRtt_ = Clock::duration::max(); ///< Minimum of the window being measured
+        Clock::time_point minRttWindowStart_{}; ///< When nextMinRtt_ started collecting
+
+        Clock::time_point roundStart_{};        ///< End of the previous round
+        size_t roundReplies_ = 0;               ///< Replies in the current round
+        Clock::duration roundMinRtt_ = Clock::duration::max(); ///< Lowest RTT of the current round
+        bool roundSaturated_ = false;           ///< The depth was reached during the round
+        double throughput_ = 0;                 ///< Replies per second, last round
+        double slowStartThroughput_ = 0;        ///< Throughput before the last slow-start doubling
+    };
+
+} // namespace tempdb
@@ -0,0 +1,210 @@
+#include "Replayer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <stdexcept>
+
+namespace tempdb {
+
+    Replayer::Replayer(const std::string& host, int port, int connections, double speed,
+                       const ConnectionProfile& profile, std::chrono::milliseconds timeout)
+        : host_(host), port_(port), connections_(connections), speed_(speed), profile_(profile),
+          timeout_(timeout) {
+
+        if (connections <= 0) {
+            throw std::runtime_error("Invalid connection count: " + std::to_string(connections));
+        }
+        if (speed < 0) {
+            throw std::runtime_error("Invalid replay speed");
+        }
+    }
+
+    int Replayer::run(const std::string& logPath, const std::string& histogramPath) {
+        auto entries = TrafficLog::load(logPath);
+        if (entries.empty()) {
+            std::cout << "Traffic log is empty, nothing to replay." << std::endl;
+            return 0;
+        }
+
+        auto networks = Network::connectAll(std::vector<std::pair<std::string, int>>(connections_, {host_, port_}),
+                                            profile_,
+                                            timeout_.count() > 0 ? std::chrono::steady_clock::now() + timeout_ : kNoDeadline);
+
+        // No batching window: records go out on schedule, only those due while the I/O thread was busy share a write
+        BatchOptions batchOptions;
+        batchOptions.window = std::chrono::microseconds(0);
+
+        std::vector<std::unique_ptr<Connection>> connections;
+        for (auto& network : networks) {
+            connections.push_back(std::make_unique<Connection>());
+            connections.back()->network = std::move(network);
+            connections.back()->batcher = std::make_unique<Batcher>(*connections.back()->network, batchOptions);
+        }
+
+        std::cout << "Replaying " << entries.size() << " commands over " << connections_ << " connection(s)";
+        if (speed_ > 0) {
+            std::cout << " at " << speed_ << "x speed" << std::endl;
+        } else {
+            std::cout << " at max speed" << std::endl;
+        }
+
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < connections_; ++i) {
+            threads.emplace_back(&Replayer::receiveLoop, this, std::ref(*connections[i]));
+            threads.emplace_back(&Replayer::sendLoop, this, std::ref(*connections[i]), std::cref(entries), i, start);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        std::vector<WorkerResult> results;
+        for (auto& connection : connections) {
+            results.push_back(std::move(connection->result));
+        }
+
+        Histogram latency = printReport(entries, results, elapsed);
+        if (!histogramPath.empty()) {
+            latency.exportToFile(histogramPath, 1000.0);
+            std::cout << "Latency histogram (us) written to " << histogramPath << std::endl;
+        }
+
+        for (const auto& result : results) {
+            if (!result.failure.empty()) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    void Replayer::sendLoop(Connection& connection, const std::vector<TrafficLog::Entry>& entries, int worker,
+                            std::chrono::steady_clock::time_point start) {
+        for (size_t i = worker; i < entries.size(); i += connections_) {
+            const auto& entry = entries[i];
+
+            {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                if (!connection.result.failure.empty()) {
+                    break;
+                }
+            }
+
+            auto intended = std::chrono::steady_clock::now();
+            if (speed_ > 0) {
+                intended = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::micro>(entry.offset.count() / speed_));
+                std::this_thread::sleep_until(intended);
+            }
+
+            Request request{intended, connection.batcher->submit(entry.command,
+                                                                 timeout_.count() > 0 ? intended + timeout_ : kNoDeadline)};
+
+            // At max speed the next record waits for this reply, so nothing is ever scheduled late
+            if (speed_ == 0) {
+                if (!complete(connection, request)) {
+                    break;
+                }
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(connection.mutex);
+                connection.requests.push_back(std::move(request));
+            }
+            connection.sent.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.sendingDone = true;
+        }
+        connection.sent.notify_one();
+    }
+
+    void Replayer::receiveLoop(Connection& connection) {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(connection.mutex);
+                connection.sent.wait(lock, [&connection] {
+                    return connection.sendingDone || !connection.requests.empty();
+                });
+                if (connection.requests.empty()) {
+                    break;
+                }
+                request = std::move(connection.requests.front());
+                connection.requests.pop_front();
+            }
+
+            if (!complete(connection, request)) {
+                break;
+            }
+        }
+    }
+
+    bool Replayer::complete(Connection& connection, const Request& request) {
+        // Latency runs from the scheduled send to when the reply was parsed, so neither
+        // a late send nor a reply observed late behind a timed-out one hides any delay
+        try {
+            auto response = request.completion->wait();
+
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.result.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                request.completion->completedAt() - request.intended).count());
+            if (response.type() == RespProtocol::ResponseType::ERROR) {
+                ++connection.result.errorReplies;
+            }
+        } catch (const TimeoutError&) {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            ++connection.result.timeouts;
+        } catch (const std::runtime_error& e) {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.result.failure = e.what();
+            return false;
+        }
+        return true;
+    }
+
+    Histogram Replayer::printReport(const std::vector<TrafficLog::Entry>& entries, const std::vector<WorkerResult>& results,
+                                    std::chrono::steady_clock::duration elapsed) {
+
+        Histogram latency;
+        size_t errorReplies = 0;
+        size_t timeouts = 0;
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& result = results[i];
+            latency.merge(result.latency);
+            errorReplies += result.errorReplies;
+            timeouts += result.timeouts;
+            if (!result.failure.empty()) {
+                std::cerr << "Connection " << i << " failed: " << result.failure << std::endl;
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double capturedSeconds = std::chrono::duration<double>(entries.back().offset).count();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Completed:     " << latency.count() << "/" << entries.size() << " commands ("
+                  << errorReplies << " error replies, " << timeouts << " timed out)" << std::endl;
+        std::cout << std::setprecision(3);
+        std::cout << "Elapsed:       " << seconds << " s (captured " << capturedSeconds << " s)" << std::endl;
+        std::cout << std::setprecision(1);
+        std::cout << "Achieved rate: " << (seconds > 0 ? latency.count() / seconds : 0.0) << " commands/s";
+        if (capturedSeconds > 0) {
+            std::cout << " (captured " << entries.size() / capturedSeconds << " commands/s)";
+        }
+        std::cout << std::endl;
+
+        if (latency.count() > 0) {
+            std::cout << "Latency (us):  " << latency.summary(1000.0) << std::endl;
+        }
+
+        return latency;
+    }
+
+} // namespace tempdb
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "Batcher.hpp"
+#include "Histogram.hpp"
+#include "Network.hpp"
+#include "TrafficLog.hpp"
+
+namespace tempdb {
+
+    /**
+    * @brief Replays a captured traffic log against a tempDB server
+    *
+    * Records are spread round-robin over a pool of connections and sent at
+    * their captured offsets scaled by the replay speed. Each connection keeps
+    * the order of its own records and pipelines them through a Batcher, so a
+    * slow reply never holds back the schedule. Latency is measured from the
+    * scheduled send time, as for open-loop load. At max speed each connection
+    * instead sends a record as soon as the previous one is answered.
+    */
+    class Replayer {
+    public:
+        /**
+        * @brief Constructor
+        * @param host Server hostname or IP address
+        * @param port Server port number
+        * @param connections Number of parallel connections
+        * @param speed Replay speed multiplier, 0 to send as fast as possible
+        * @param profile Socket tuning profile
+        * @param timeout Per-command timeout, zero for none
+        */
+        Replayer(const std::string& host, int port, int connections, double speed,
+                 const ConnectionProfile& profile = ConnectionProfile(),
+                 std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+        /**
+        * @brief Replay a traffic log and print the achieved rate and latency
+        * @param logPath Traffic log file path
+        * @param histogramPath File to export the latency distribution to, empty to skip
+        * @return Exit status (0 for success, non-zero for error)
+        */
+        int run(const std::string& logPath, const std::string& histogramPath = "");
+
+    private:
+        /**
+        * @brief Per-connection replay results
+        */
+        struct WorkerResult {
+            Histogram latency;                                  ///< Latency of every completed command, in ns
+            size_t errorReplies = 0;                            ///< Replies of type ERROR
+            size_t timeouts = 0;                                ///< Commands that missed their deadline
+            std::string failure;                                ///< Connection failure, empty if none
+        };
+
+        /**
+        * @brief A submitted record, awaiting its reply
+        */
+        struct Request {
+            std::chrono::steady_clock::time_point intended;     ///< Scheduled send time
+            std::shared_ptr<Batcher::Completion> completion;    ///< Completed by the batcher
+        };
+
+        /**
+        * @brief State shared by the sender and receiver of one connection
+        */
+        struct Connection {
+            std::unique_ptr<Network> network;                   ///< The connection
+            std::unique_ptr<Batcher> batcher;                   ///< Pipelines the records on network
+            std::mutex mutex;                                   ///< Guards the members below
+            std::condition_variable sent;                       ///< Signalled on every submission
+            std::deque<Request> requests;                       ///< Records awaiting replies, in send order
+            bool sendingDone = false;                           ///< Sender has stopped
+            WorkerResult result;                                ///< Collected results
+        };
+
+        /**
+        * @brief Submit every record assigned to one connection at its scheduled time
+        * @param connection Connection to replay on
+        * @param entries All records of the log
+        * @param worker Connection index
+        * @param start Replay start time
+        */
+        void sendLoop(Connection& connection, const std::vector<TrafficLog::Entry>& entries, int worker,
+                      std::chrono::steady_clock::time_point start);
+
+        /**
+        * @brief Wait for the replies of one connection in order
+        */
+        void receiveLoop(Connection& connection);
+
+        /**
+        * @brief Wait for one record's reply and record its outcome
+        * @return false if the connection failed
+        */
+        bool complete(Connection& connection, const Request& request);
+
+        /**
+        * @brief Print the replay summary
+        * @return Latency of every completed command, in ns
+        */
+        Histogram printReport(const std::vector<TrafficLog::Entry>& entries, const std::vector<WorkerResult>& results,
+                              std::chrono::steady_clock::duration elapsed);
+
+        std::string host_;      ///< Server hostname
+        int port_;              ///< Server port
+        int connections_;       ///< Number of parallel connections
+        double speed_;          ///< Replay speed multiplier, 0 for max
+        ConnectionProfile profile_; ///< Socket tuning profile
+        std::chrono::milliseconds timeout_; ///< Per-command timeout, zero for none
+    };
+
+} // namespace tempdb
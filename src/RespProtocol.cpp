@@ -2,189 +2,519 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 
 namespace tempdb {
 
-std::vector<std::string> RespProtocol::splitInput(const std::string& input) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(input);
-    std::string token;
+namespace {
 
-    while (iss >> token) {
-        tokens.push_back(token);
+// Calls visit(start, length) for every whitespace-separated token of input
+template <typename Visit>
+void forEachToken(const std::string& input, Visit visit) {
+    size_t pos = 0;
+    while (true) {
+        while (pos < input.size() && std::isspace(static_cast<unsigned char>(input[pos]))) {
+            ++pos;
+        }
+        if (pos == input.size()) {
+            return;
+        }
+
+        size_t start = pos;
+        while (pos < input.size() && !std::isspace(static_cast<unsigned char>(input[pos]))) {
+            ++pos;
+        }
+        visit(start, pos - start);
     }
+}
+
+} // namespace
 
+std::vector<std::string> RespProtocol::splitInput(const std::string& input) {
+    std::vector<std::string> tokens;
+    splitInput(input, tokens);
     return tokens;
 }
 
+void RespProtocol::splitInput(const std::string& input, std::vector<std::string>& tokens) {
+    size_t count = 0;
+    forEachToken(input, [&](size_t start, size_t length) {
+        if (count == tokens.size()) {
+            tokens.emplace_back();
+        }
+        tokens[count++].assign(input, start, length);
+    });
+    tokens.resize(count);
+}
+
+void RespProtocol::splitInput(const std::string& input, std::vector<std::string>& tokens, ResponsePool& pool) {
+    size_t count = 0;
+    forEachToken(input, [&](size_t start, size_t length) {
+        if (count == tokens.size()) {
+            tokens.push_back(pool.takeString(length));
+        } else if (tokens[count].capacity() < length) {
+            // Trade the buffer for a big enough spare rather than growing it
+            std::string spare = pool.takeString(length);
+            std::swap(spare, tokens[count]);
+            pool.recycle(std::move(spare));
+        }
+        tokens[count++].assign(input, start, length);
+    });
+
+    // Keep the buffers of the previous command's extra tokens for the next long one
+    while (tokens.size() > count) {
+        pool.recycle(std::move(tokens.back()));
+        tokens.pop_back();
+    }
+}
+
 
 std::string RespProtocol::encodeArray(const std::vector<std::string>& tokens) {
-    std::ostringstream resp;
+    std::string resp;
+    encodeArray(tokens, resp);
+    return resp;
+}
 
-    resp << "*" << tokens.size() << "\r\n";
+void RespProtocol::encodeArray(const std::vector<std::string>& tokens, std::string& out) {
+    char number[24];
+    auto appendNumber = [&out, &number](size_t value) {
+        auto result = std::to_chars(number, number + sizeof(number), value);
+        out.append(number, result.ptr - number);
+    };
+
+    out.clear();
+    out += '*';
+    appendNumber(tokens.size());
+    out += "\r\n";
     for (const auto& t : tokens) {
-        resp << "$" << t.size() << "\r\n" << t << "\r\n";
+        out += '$';
+        appendNumber(t.size());
+        out += "\r\n";
+        out += t;
+        out += "\r\n";
+    }
+}
+
+RespProtocol::ResponsePool::ResponsePool(size_t maxSpares) : maxSpares_(maxSpares) {
+    strings_.reserve(maxSpares);
+    arrays_.reserve(maxSpares);
+}
+
+void RespProtocol::ResponsePool::recycle(Response&& response) {
+    if (std::string* text = std::get_if<std::string>(&response.data_)) {
+        recycle(std::move(*text));
+    } else if (std::vector<Response>* elements = std::get_if<std::vector<Response>>(&response.data_)) {
+        for (auto& element : *elements) {
+            recycle(std::move(element));
+        }
+        if (arrays_.size() < maxSpares_) {
+            elements->clear();
+            arrays_.push_back(std::move(*elements));
+        }
+    }
+    response.data_ = std::monostate();
+}
+
+void RespProtocol::ResponsePool::recycle(std::string&& buffer) {
+    // Buffers that fit inline in a std::string are not worth keeping
+    if (strings_.size() < maxSpares_ && buffer.capacity() > std::string().capacity()) {
+        buffer.clear();
+        strings_.push_back(std::move(buffer));
+    }
+}
+
+std::string RespProtocol::ResponsePool::takeString(size_t length) {
+    if (strings_.empty()) {
+        return std::string();
     }
-    return resp.str();
+
+    // Smallest spare that fits, so large buffers stay available for large values; else the largest
+    size_t best = 0;
+    for (size_t i = 1; i < strings_.size(); ++i) {
+        size_t capacity = strings_[i].capacity();
+        size_t bestCapacity = strings_[best].capacity();
+        bool fits = capacity >= length;
+        bool bestFits = bestCapacity >= length;
+        if ((fits && (!bestFits || capacity < bestCapacity)) || (!fits && !bestFits && capacity > bestCapacity)) {
+            best = i;
+        }
+    }
+
+    std::string spare = std::move(strings_[best]);
+    strings_[best] = std::move(strings_.back());
+    strings_.pop_back();
+    return spare;
+}
+
+std::vector<RespProtocol::Response> RespProtocol::ResponsePool::takeArray() {
+    if (arrays_.empty()) {
+        return std::vector<Response>();
+    }
+    std::vector<Response> spare = std::move(arrays_.back());
+    arrays_.pop_back();
+    return spare;
+}
+
+RespProtocol::Response RespProtocol::Response::string(ResponseType type, std::string_view text) {
+    Response response;
+    response.type_ = type;
+
+    if (text.size() <= kInlineCapacity) {
+        InlineString small;
+        small.size = static_cast<uint8_t>(text.size());
+        std::memcpy(small.data, text.data(), text.size());
+        response.data_ = small;
+    } else {
+        response.data_ = std::string(text);
+    }
+    return response;
+}
+
+RespProtocol::Response RespProtocol::Response::string(ResponseType type, std::string_view text, std::string&& storage) {
+    if (text.size() <= kInlineCapacity) {
+        return string(type, text);
+    }
+
+    Response response;
+    response.type_ = type;
+    storage.assign(text.data(), text.size());
+    response.data_ = std::move(storage);
+    return response;
+}
+
+RespProtocol::Response RespProtocol::Response::integer(int64_t value) {
+    Response response;
+    response.type_ = ResponseType::INTEGER;
+    response.data_ = value;
+    return response;
+}
+
+RespProtocol::Response RespProtocol::Response::nil() {
+    Response response;
+    response.type_ = ResponseType::NIL;
+    return response;
+}
+
+RespProtocol::Response RespProtocol::Response::array(std::vector<Response>&& elements) {
+    Response response;
+    response.type_ = ResponseType::ARRAY;
+    response.data_ = std::move(elements);
+    return response;
+}
+
+int64_t RespProtocol::Response::integerValue() const {
+    const int64_t* value = std::get_if<int64_t>(&data_);
+    return value ? *value : 0;
+}
+
+std::string_view RespProtocol::Response::text() const {
+    if (const InlineString* small = std::get_if<InlineString>(&data_)) {
+        return std::string_view(small->data, small->size);
+    }
+    if (const std::string* large = std::get_if<std::string>(&data_)) {
+        return *large;
+    }
+    return std::string_view();
+}
+
+const std::vector<RespProtocol::Response>& RespProtocol::Response::elements() const {
+    static const std::vector<Response> empty;
+    const std::vector<Response>* elements = std::get_if<std::vector<Response>>(&data_);
+    return elements ? *elements : empty;
+}
+
+std::vector<RespProtocol::Response> RespProtocol::Response::releaseElements() {
+    std::vector<Response> released;
+    if (std::vector<Response>* elements = std::get_if<std::vector<Response>>(&data_)) {
+        released = std::move(*elements);
+        elements->clear();
+    }
+    return released;
 }
 
 RespProtocol::Response RespProtocol::parseResponse(const std::string& response) {
 
-    
     if (response.empty()) {
-        return Response(ResponseType::UNKNOWN, "(empty response)");
+        return Response::string(ResponseType::UNKNOWN, "(empty response)");
     }
 
     size_t pos = 0;
-    char responseType = response[pos];
+    return parseAt(response, pos, nullptr);
+}
+
+RespProtocol::Response RespProtocol::parseResponse(const std::string& response, ResponsePool& pool) {
 
-    switch (responseType) {
+    if (response.empty()) {
+        return Response::string(ResponseType::UNKNOWN, "(empty response)");
+    }
+
+    size_t pos = 0;
+    return parseAt(response, pos, &pool);
+}
+
+RespProtocol::Response RespProtocol::makeString(ResponseType type, std::string_view text, ResponsePool* pool) {
+    if (pool == nullptr || text.size() <= Response::kInlineCapacity) {
+        return Response::string(type, text);
+    }
+    return Response::string(type, text, pool->takeString(text.size()));
+}
+
+size_t RespProtocol::replyLength(const std::string& buffer, size_t pos) {
+    ReplyFramer framer;
+    return framer.measure(buffer, pos);
+}
+
+RespProtocol::ReplyFramer::ReplyFramer() {
+    remaining_.reserve(kReservedDepth);
+}
+
+size_t RespProtocol::ReplyFramer::measure(const std::string& buffer, size_t start) {
+
+    if (length_ != 0) {
+        return length_;
+    }
+    if (start >= buffer.size()) {
+        return 0;
+    }
+
+    const std::string_view reply = std::string_view(buffer).substr(start);
+
+    while (true) {
+        if (bulkEnd_ != 0) {
+            // The payload length is known, so its bytes need no scanning
+            if (reply.size() < bulkEnd_) {
+                return 0;
+            }
+            pos_ = bulkEnd_;
+            scanned_ = pos_;
+            bulkEnd_ = 0;
+            if (finishElement()) {
+                return length_ = pos_;
+            }
+            continue;
+        }
+
+        if (pos_ >= reply.size()) {
+            return 0;
+        }
+
+        size_t rn = reply.find("\r\n", std::max(scanned_, pos_ + 1));
+        if (rn == std::string_view::npos) {
+            // The \r may already be here with its \n still to come
+            scanned_ = std::max(pos_ + 1, reply.size() - 1);
+            return 0;
+        }
+
+        const std::string_view header = reply.substr(pos_ + 1, rn - pos_ - 1);
+        const char type = reply[pos_];
+        pos_ = rn + 2;
+        scanned_ = pos_;
+
+        switch (type) {
+            case '+':
+            case '-':
+            case ':':
+                break;
+            case '$': {
+                long len = parseLength(header, "bulk string");
+                if (len >= 0) {
+                    // Payload and the trailing \r\n
+                    bulkEnd_ = pos_ + static_cast<size_t>(len) + 2;
+                    continue;
+                }
+                break;
+            }
+            case '*': {
+                long numElements = parseLength(header, "array");
+                if (numElements > 0) {
+                    remaining_.push_back(numElements);
+                    continue;
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("Invalid RESP reply type");
+        }
+
+        if (finishElement()) {
+            return length_ = pos_;
+        }
+    }
+}
+
+void RespProtocol::ReplyFramer::reset() {
+    pos_ = 0;
+    scanned_ = 0;
+    bulkEnd_ = 0;
+    length_ = 0;
+    remaining_.clear();
+}
+
+bool RespProtocol::ReplyFramer::finishElement() {
+    // A finished element may finish the arrays that hold it
+    while (!remaining_.empty()) {
+        if (--remaining_.back() > 0) {
+            return false;
+        }
+        remaining_.pop_back();
+    }
+    return true;
+}
+
+RespProtocol::Response RespProtocol::parseAt(std::string_view response, size_t& pos, ResponsePool* pool) {
+
+    if (pos >= response.size()) {
+        throw std::runtime_error("RESP array incomplete");
+    }
+
+    switch (response[pos]) {
         case '+':
-            return parseSimpleString(response, pos);
+            return parseSimpleString(response, pos, pool);
         case '-':
-            return parseError(response, pos);
+            return parseError(response, pos, pool);
         case ':':
             return parseInteger(response, pos);
         case '$':
-            return parseBulkString(response, pos);
+            return parseBulkString(response, pos, pool);
         case '*':
-            return parseArray(response, pos);
+            return parseArray(response, pos, pool);
         default:
-            return Response(ResponseType::UNKNOWN, "[Unrecognized response]");
+            pos = response.size();
+            return Response::string(ResponseType::UNKNOWN, "[Unrecognized response]");
     }
 }
 
-RespProtocol::Response RespProtocol::parseSimpleString(const std::string& response, size_t& pos) {
+std::string_view RespProtocol::readLine(std::string_view response, size_t& pos, const char* what) {
 
     size_t end = response.find("\r\n", pos + 1);
-    if (end == std::string::npos) {
-        throw std::runtime_error("Invalid RESP simple string format");
+    if (end == std::string_view::npos) {
+        throw std::runtime_error(std::string("Invalid RESP ") + what + " format");
     }
 
-    std::string value = response.substr(pos + 1, end - pos - 1);
-    pos = end + 1;
-    return Response(ResponseType::SIMPLE_STRING, value);
+    std::string_view line = response.substr(pos + 1, end - pos - 1);
+    pos = end + 2;
+    return line;
 }
 
-RespProtocol::Response RespProtocol::parseError(const std::string& response, size_t& pos) {
-    
-    //Same as Simple String
-    size_t end = response.find("\r\n", pos + 1);
-    if (end == std::string::npos) {
-        throw std::runtime_error("Invalid RESP error format");
+long RespProtocol::parseLength(std::string_view line, const char* what) {
+
+    long length = 0;
+    auto result = std::from_chars(line.data(), line.data() + line.size(), length);
+    if (result.ec != std::errc() || result.ptr != line.data() + line.size()) {
+        throw std::runtime_error(std::string("Invalid RESP ") + what + " length");
     }
+    return length;
+}
 
-    std::string value = response.substr(pos + 1, end - pos - 1);
-    pos = end + 1;
-    return Response(ResponseType::ERROR, value);
+RespProtocol::Response RespProtocol::parseSimpleString(std::string_view response, size_t& pos, ResponsePool* pool) {
+    return makeString(ResponseType::SIMPLE_STRING, readLine(response, pos, "simple string"), pool);
 }
 
-RespProtocol::Response RespProtocol::parseInteger(const std::string& response, size_t& pos) {
-    
+RespProtocol::Response RespProtocol::parseError(std::string_view response, size_t& pos, ResponsePool* pool) {
     //Same as Simple String
-    size_t end = response.find("\r\n", pos + 1);
-    if (end == std::string::npos) {
+    return makeString(ResponseType::ERROR, readLine(response, pos, "error"), pool);
+}
+
+RespProtocol::Response RespProtocol::parseInteger(std::string_view response, size_t& pos) {
+
+    std::string_view line = readLine(response, pos, "integer");
+
+    int64_t value = 0;
+    auto result = std::from_chars(line.data(), line.data() + line.size(), value);
+    if (result.ec != std::errc() || result.ptr != line.data() + line.size()) {
         throw std::runtime_error("Invalid RESP integer format");
     }
 
-    std::string value = response.substr(pos + 1, end - pos - 1);
-    pos = end + 1;
-    return Response(ResponseType::INTEGER, value);
+    return Response::integer(value);
 }
 
-RespProtocol::Response RespProtocol::parseBulkString(const std::string& response, size_t& pos) {
-    
-    // Find the end of the length line
-    size_t rn = response.find("\r\n", pos + 1);
-    if (rn == std::string::npos) {
-        throw std::runtime_error("Invalid RESP bulk string format");
-    }
+RespProtocol::Response RespProtocol::parseBulkString(std::string_view response, size_t& pos, ResponsePool* pool) {
 
-    int len = std::stoi(response.substr(pos + 1, rn - pos - 1));
-    if (len == -1) {
-        pos = rn + 1;
-        return Response(ResponseType::BULK_STRING, "");
+    // Length line
+    std::string_view line = readLine(response, pos, "bulk string");
+
+    long len = parseLength(line, "bulk string");
+    if (len < 0) {
+        return Response::nil();
     }
 
-    // Calculate start position of the actual string
-    size_t start = rn + 2;
-    if (start + len > response.size()) {
+    // pos now points at the actual string
+    if (static_cast<size_t>(len) > response.size() - pos || response.size() - pos - len < 2) {
         throw std::runtime_error("RESP bulk string length mismatch");
     }
 
-    std::string value = response.substr(start, len);
-    pos = start + len + 1; // Skip the string + final \r\n
-    return Response(ResponseType::BULK_STRING, value);
+    std::string_view value = response.substr(pos, len);
+    pos += len + 2; // Skip the string + final \r\n
+    return makeString(ResponseType::BULK_STRING, value, pool);
 }
 
-RespProtocol::Response RespProtocol::parseArray(const std::string& response, size_t& pos) {
-    
-    // Find the end of the array length line
-    size_t rn = response.find("\r\n", pos + 1);
-    if (rn == std::string::npos) {
-        throw std::runtime_error("Invalid RESP array format");
-    }
+RespProtocol::Response RespProtocol::parseArray(std::string_view response, size_t& pos, ResponsePool* pool) {
 
-    int numElements = std::stoi(response.substr(pos + 1, rn - pos - 1));
+    // Array length line
+    std::string_view line = readLine(response, pos, "array");
 
-    if (numElements == -1) {
-        pos = rn + 1;
-        return Response(ResponseType::ARRAY, "");
+    long numElements = parseLength(line, "array");
+    if (numElements < 0) {
+        return Response::nil();
     }
 
-    std::vector<std::string> elements;
-    size_t currentPos = rn + 2;
+    // The count comes off the wire: every element takes at least 3 bytes ("+\r\n"),
+    // so never reserve for more than the bytes left could hold
+    std::vector<Response> elements = pool ? pool->takeArray() : std::vector<Response>();
+    elements.reserve(std::min(static_cast<size_t>(numElements), (response.size() - pos) / 3));
 
-    for (int i = 0; i < numElements; ++i) {
-        if (currentPos >= response.size()) {
-            throw std::runtime_error("RESP array incomplete");
-        }
-
-        Response element = parseResponse(response.substr(currentPos));
-        if (element.type == ResponseType::BULK_STRING) {
-            elements.push_back(element.value);
-        } else {
-            elements.push_back(humanize(element));
-        }
-
-        currentPos += response.size(); 
-        break; 
+    for (long i = 0; i < numElements; ++i) {
+        elements.push_back(parseAt(response, pos, pool));
     }
 
-    pos = response.size() - 1;
-    return Response(ResponseType::ARRAY, "", elements);
+    return Response::array(std::move(elements));
 }
 
 
 std::string RespProtocol::humanize(const Response& response) {
-    
-    switch (response.type) {
+    std::ostringstream oss;
+    humanize(response, oss);
+    return oss.str();
+}
+
+void RespProtocol::humanize(const Response& response, std::ostream& out) {
+
+    switch (response.type()) {
         case ResponseType::SIMPLE_STRING:
-            return response.value;
+            out << response.text();
+            break;
         case ResponseType::ERROR:
-            return "Error: " + response.value;
+            out << "Error: " << response.text();
+            break;
         case ResponseType::INTEGER:
-            return response.value;
+            out << response.integerValue();
+            break;
         case ResponseType::BULK_STRING:
-            return response.value.empty() ? "(nil)" : response.value;
+            out << response.text();
+            break;
+        case ResponseType::NIL:
+            out << "(nil)";
+            break;
         case ResponseType::ARRAY:
-            if (response.arrayElements.empty()) {
-                return "(empty array)";
+            if (response.elements().empty()) {
+                out << "(empty array)";
+                break;
             }
-            {
-                std::ostringstream oss;
-                for (size_t i = 0; i < response.arrayElements.size(); ++i) {
-                    if (i > 0)
-                        oss << " ";
-                    oss << response.arrayElements[i];
-                }
-                return oss.str();
+            for (size_t i = 0; i < response.elements().size(); ++i) {
+                if (i > 0)
+                    out << " ";
+                humanize(response.elements()[i], out);
             }
+            break;
         case ResponseType::UNKNOWN:
         default:
-            return response.value;
+            out << response.text();
+            break;
     }
 }
 
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <variant>
 #include <vector>
 
 namespace tempdb {
@@ -17,25 +21,187 @@ public:
     /**
     * @brief Types of RESP protocol messages supported
     */
-    enum class ResponseType {
+    enum class ResponseType : uint8_t {
         SIMPLE_STRING,  // +<string>\r\n
         ERROR,          // -<error message>\r\n
         INTEGER,        // :<number>\r\n
         BULK_STRING,    // $<length>\r\n<data>\r\n
         ARRAY,          // *<count>\r\n<elements...>
+        NIL,            // $-1\r\n or *-1\r\n
         UNKNOWN         // Unrecognized message type
     };
 
+    class ResponsePool;
+
     /**
-     * @brief Structure to hold a parsed RESP response
+     * @brief Parsed RESP response stored as a compact tagged union
+     *
+     * Integers are kept as int64, strings up to kInlineCapacity bytes are stored
+     * inline without a heap allocation, longer strings own a single buffer and
+     * nil is a distinct state. Responses are move-only so replies are never
+     * copied on their way out of the parser.
      */
-    struct Response {
-        ResponseType type;
-        std::string value;
-        std::vector<std::string> arrayElements;
+    class Response {
+    public:
+        static constexpr size_t kInlineCapacity = 23;   ///< Longest string stored inline
+
+        Response() = default;
+        Response(Response&&) noexcept = default;
+        Response& operator=(Response&&) noexcept = default;
+        Response(const Response&) = delete;
+        Response& operator=(const Response&) = delete;
+
+        /**
+         * @brief Create a string-valued response (simple string, error, bulk string, unknown)
+         * @param type Response type
+         * @param text String payload
+         */
+        static Response string(ResponseType type, std::string_view text);
+
+        /**
+         * @brief Create a string-valued response, reusing a spare buffer for long text
+         * @param type Response type
+         * @param text String payload
+         * @param storage Buffer that holds the text if it is too long to store inline
+         */
+        static Response string(ResponseType type, std::string_view text, std::string&& storage);
+
+        /**
+         * @brief Create an integer response
+         * @param value Integer payload
+         */
+        static Response integer(int64_t value);
+
+        /**
+         * @brief Create a nil response
+         */
+        static Response nil();
+
+        /**
+         * @brief Create an array response
+         * @param elements Array elements, moved into the response
+         */
+        static Response array(std::vector<Response>&& elements);
+
+        ResponseType type() const { return type_; }
+        bool isNil() const { return type_ == ResponseType::NIL; }
 
-        Response(ResponseType t = ResponseType::UNKNOWN, const std::string& v = "", const std::vector<std::string>& arr = {})
-            : type(t), value(v), arrayElements(arr) {}
+        /**
+         * @brief Integer payload, 0 for non-integer responses
+         */
+        int64_t integerValue() const;
+
+        /**
+         * @brief String payload, empty for integer, nil and array responses
+         */
+        std::string_view text() const;
+
+        /**
+         * @brief Array elements, empty for non-array responses
+         */
+        const std::vector<Response>& elements() const;
+
+        /**
+         * @brief Move the array elements out, leaving an empty array behind
+         */
+        std::vector<Response> releaseElements();
+
+    private:
+        friend class ResponsePool;
+
+        struct InlineString {
+            uint8_t size;
+            char data[kInlineCapacity];
+        };
+
+        ResponseType type_ = ResponseType::UNKNOWN;
+        std::variant<std::monostate, int64_t, InlineString, std::string, std::vector<Response>> data_;
+    };
+
+    /**
+     * @brief Freelist of reply and token storage
+     *
+     * Recycled replies give up their heap buffers (long strings and element
+     * vectors), and replies parsed with the pool reuse them, so a caller that
+     * recycles every reply it is done with stops allocating once the pool has
+     * warmed up. Command tokens draw on the same string buffers. Not
+     * thread-safe: keep one pool per connection or thread.
+     */
+    class ResponsePool {
+    public:
+        /**
+        * @brief Constructor
+        * @param maxSpares Most buffers of each kind kept, the rest are freed
+        */
+        explicit ResponsePool(size_t maxSpares = 64);
+
+        /**
+        * @brief Take back the buffers of a reply that is no longer needed
+        * @param response Reply, consumed
+        */
+        void recycle(Response&& response);
+
+        /**
+        * @brief Take back a string buffer that is no longer needed
+        * @param buffer Buffer, consumed
+        */
+        void recycle(std::string&& buffer);
+
+        /**
+        * @brief Take a spare string buffer, empty
+        * @param length Bytes the caller is about to store, used to pick the best fitting spare
+        * @return Spare buffer, or a new empty string if none is left
+        */
+        std::string takeString(size_t length);
+
+    private:
+        friend class RespProtocol;
+
+        std::vector<Response> takeArray();
+
+        size_t maxSpares_;                          ///< Cap on each freelist
+        std::vector<std::string> strings_;          ///< Spare string buffers, cleared
+        std::vector<std::vector<Response>> arrays_; ///< Spare element vectors, cleared
+    };
+
+    /**
+     * @brief Finds where a reply ends while its bytes arrive in pieces
+     *
+     * Keeps the parse position, the open arrays and the declared length of
+     * the bulk string being received between calls, so a reply fed in many
+     * reads is scanned once rather than from its start on every read.
+     */
+    class ReplyFramer {
+    public:
+        /**
+        * @brief Constructor, sizes the array stack up front so framing does not allocate
+        */
+        ReplyFramer();
+
+        /**
+        * @brief Measure the reply starting at an offset, resuming where the last call stopped
+        * @param buffer Bytes received so far; only appended to between calls
+        * @param start Offset of the reply within the buffer, the same on every call
+        * @return Length of the complete reply in bytes, or 0 if more data is needed
+        * @throws std::runtime_error if the buffer does not hold a valid RESP reply
+        */
+        size_t measure(const std::string& buffer, size_t start = 0);
+
+        /**
+        * @brief Forget the measured reply, ready for the next one
+        */
+        void reset();
+
+    private:
+        static constexpr size_t kReservedDepth = 8; ///< Array nesting handled without allocating
+
+        bool finishElement();
+
+        size_t pos_ = 0;              ///< Offset of the next element header from the reply start
+        size_t scanned_ = 0;          ///< Offset the search for the header's \r\n resumes from
+        size_t bulkEnd_ = 0;          ///< End of the bulk string being received, 0 if none
+        size_t length_ = 0;           ///< Length of the complete reply, 0 until it is complete
+        std::vector<long> remaining_; ///< Elements still to come in each open array, innermost last
     };
 
     /**
@@ -45,6 +211,25 @@ public:
      */
     static std::vector<std::string> splitInput(const std::string& input);
 
+    /**
+     * @brief Splits input string into tokens, reusing the strings already in the vector
+     * @param input The input string to split
+     * @param tokens Replaced by the tokens
+     */
+    static void splitInput(const std::string& input, std::vector<std::string>& tokens);
+
+    /**
+     * @brief Splits input string into tokens, trading string buffers with a pool
+     *
+     * Tokens left over from a longer previous command go back to the pool and
+     * new tokens take the best fitting spare, so a mix of commands with
+     * different argument counts and sizes settles without allocating.
+     * @param input The input string to split
+     * @param tokens Replaced by the tokens
+     * @param pool Freelist of string buffers
+     */
+    static void splitInput(const std::string& input, std::vector<std::string>& tokens, ResponsePool& pool);
+
     /**
      * @brief Encodes a vector of strings as a RESP array
      * @param tokens Strings to encode
@@ -52,6 +237,13 @@ public:
      */
     static std::string encodeArray(const std::vector<std::string>& tokens);
 
+    /**
+     * @brief Encodes a vector of strings as a RESP array into a reusable buffer
+     * @param tokens Strings to encode
+     * @param out Replaced by the RESP-formatted request
+     */
+    static void encodeArray(const std::vector<std::string>& tokens, std::string& out);
+
     /**
      * @brief Parses a RESP-formatted response
      * @param response The raw RESP message
@@ -59,6 +251,23 @@ public:
      */
     static Response parseResponse(const std::string& response);
 
+    /**
+     * @brief Parses a RESP-formatted response using recycled storage
+     * @param response The raw RESP message
+     * @param pool Freelist the reply's buffers are taken from
+     * @return Parsed Response object
+     */
+    static Response parseResponse(const std::string& response, ResponsePool& pool);
+
+    /**
+     * @brief Measures the first complete RESP reply in a buffer
+     * @param buffer Bytes received so far
+     * @param pos Offset of the reply within the buffer
+     * @return Length of the complete reply in bytes, or 0 if more data is needed
+     * @throws std::runtime_error if the buffer does not hold a valid RESP reply
+     */
+    static size_t replyLength(const std::string& buffer, size_t pos = 0);
+
     /**
      * @brief Converts a RESP representation to human-readable string
      * @param response The Response to convert
@@ -66,13 +275,25 @@ public:
      */
     static std::string humanize(const Response& response);
 
+    /**
+     * @brief Writes the human-readable form of a response to a stream
+     * @param response The Response to convert
+     * @param out Stream to write to
+     */
+    static void humanize(const Response& response, std::ostream& out);
+
 private:
-    // Private methods for parsing RESP types
-    static Response parseSimpleString(const std::string& response, size_t& pos);
-    static Response parseError(const std::string& response, size_t& pos);
-    static Response parseInteger(const std::string& response, size_t& pos);
-    static Response parseBulkString(const std::string& response, size_t& pos);
-    static Response parseArray(const std::string& response, size_t& pos);
+    // Private methods for parsing RESP types, pos is advanced past the parsed reply.
+    // pool, when set, supplies the buffers of long strings and arrays
+    static Response parseAt(std::string_view response, size_t& pos, ResponsePool* pool);
+    static Response parseSimpleString(std::string_view response, size_t& pos, ResponsePool* pool);
+    static Response parseError(std::string_view response, size_t& pos, ResponsePool* pool);
+    static Response parseInteger(std::string_view response, size_t& pos);
+    static Response parseBulkString(std::string_view response, size_t& pos, ResponsePool* pool);
+    static Response parseArray(std::string_view response, size_t& pos, ResponsePool* pool);
+    static Response makeString(ResponseType type, std::string_view text, ResponsePool* pool);
+    static std::string_view readLine(std::string_view response, size_t& pos, const char* what);
+    static long parseLength(std::string_view line, const char* what);
 
 };
 
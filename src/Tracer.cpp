@@ -0,0 +1,136 @@
+#include "Tracer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        bool isSet(Tracer::TimePoint time) {
+            return time != Tracer::TimePoint();
+        }
+
+        // Trace timestamps are microseconds since the first span started
+        double micros(Tracer::TimePoint time, Tracer::TimePoint origin) {
+            return std::chrono::duration<double, std::micro>(time - origin).count();
+        }
+
+        std::string escapeJson(const std::string& text) {
+            std::string out;
+            for (unsigned char c : text) {
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                    out += static_cast<char>(c);
+                } else if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += static_cast<char>(c);
+                }
+            }
+            return out;
+        }
+
+    } // namespace
+
+    Tracer& Tracer::instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    uint32_t Tracer::threadIndex() {
+        static std::atomic<uint32_t> nextThread{1};
+        thread_local uint32_t index = nextThread.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    void Tracer::record(Span&& span) {
+        uint32_t thread = threadIndex();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (spans_.size() >= kMaxSpans) {
+            ++dropped_;
+            return;
+        }
+        spans_.push_back(Entry{std::move(span), thread});
+    }
+
+    void Tracer::write(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        TimePoint origin = TimePoint::max();
+        for (const auto& entry : spans_) {
+            origin = std::min(origin, entry.span.start);
+        }
+
+        char number[32];
+        auto format = [&number](double value) {
+            std::snprintf(number, sizeof(number), "%.3f", value);
+            return number;
+        };
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        auto event = [&](const std::string& name, const char* category, uint32_t thread, TimePoint from, TimePoint to) {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << thread << ",\"ts\":" << format(micros(from, origin));
+            out << ",\"dur\":" << format(micros(to, from)) << "}";
+        };
+
+        for (const auto& entry : spans_) {
+            const Span& span = entry.span;
+            if (!isSet(span.start) || !isSet(span.end)) {
+                continue;
+            }
+
+            // Request first, so viewers nest the phases (same thread, contained intervals) under it
+            event(escapeJson(span.name), "request", entry.thread, span.start, span.end);
+
+            const struct {
+                const char* name;
+                TimePoint from;
+                TimePoint to;
+            } phases[] = {
+                {"tokenize", span.start, span.enqueued},
+                {"send", span.enqueued, span.firstByteWritten},
+                {"server", span.firstByteWritten, span.firstReplyByte},
+                {"receive", span.firstReplyByte, span.replyComplete},
+                {"render", span.replyComplete, span.end},
+            };
+            for (const auto& phase : phases) {
+                if (isSet(phase.from) && isSet(phase.to) && phase.to >= phase.from) {
+                    event(phase.name, "phase", entry.thread, phase.from, phase.to);
+                }
+            }
+
+            if (isSet(span.kernelReceived)) {
+                out << ",\n{\"name\":\"kernel rx\",\"cat\":\"wire\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+                    << entry.thread << ",\"ts\":" << format(micros(span.kernelReceived, origin));
+                if (isSet(span.firstReplyByte)) {
+                    out << ",\"args\":{\"until_read_us\":" << format(micros(span.firstReplyByte, span.kernelReceived))
+                        << "}";
+                }
+                out << "}";
+            }
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":" << dropped_ << "}}\n";
+    }
+
+    void Tracer::writeToFile(const std::string& path) const {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Error: Could not open trace file: " + path);
+        }
+        write(out);
+        if (!out) {
+            throw std::runtime_error("Error: Failed to write trace file: " + path);
+        }
+    }
+
+} // namespace tempdb
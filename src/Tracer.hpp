@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tempdb {
+
+    /**
+    * @brief Process-wide collector of per-request tracing spans
+    *
+    * Disabled by default; while disabled callers skip taking timestamps
+    * altogether. Spans are kept in memory and exported on demand in the Chrome
+    * trace event format, which chrome://tracing and Perfetto open directly.
+    */
+    class Tracer {
+    public:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        static constexpr size_t kMaxSpans = 1000000;    ///< Spans beyond this are counted and dropped
+
+        /**
+        * @brief Timeline of one request, monotonic clock
+        *
+        * A default-constructed (zero) time point marks a phase that was not
+        * observed, e.g. the kernel timestamp on a socket without SO_TIMESTAMPING.
+        */
+        struct Span {
+            std::string name;               ///< Command name
+            TimePoint start{};              ///< Input received, before tokenizing
+            TimePoint enqueued{};           ///< Encoded and handed to the send path
+            TimePoint firstByteWritten{};   ///< The socket accepted the first byte of the request
+            TimePoint kernelReceived{};     ///< Kernel receive timestamp of the first reply byte
+            TimePoint firstReplyByte{};     ///< The first reply byte was read from the socket
+            TimePoint replyComplete{};      ///< The whole reply was read
+            TimePoint end{};                ///< The reply was decoded and rendered
+        };
+
+        /**
+        * @brief The process-wide tracer
+        */
+        static Tracer& instance();
+
+        /**
+        * @brief Start collecting spans
+        */
+        void enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+        bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+        /**
+        * @brief Keep a finished span, tagged with the calling thread
+        */
+        void record(Span&& span);
+
+        /**
+        * @brief Write every span as Chrome trace event JSON
+        *
+        * Each request becomes a complete event with nested tokenize, send,
+        * server, receive and render phases, plus an instant event at the kernel
+        * receive timestamp when one was taken.
+        */
+        void write(std::ostream& out) const;
+
+        /**
+        * @brief Write every span to a file, replacing it
+        * @throws std::runtime_error if the file cannot be written
+        */
+        void writeToFile(const std::string& path) const;
+
+    private:
+        /**
+        * @brief Span with the thread it was recorded on
+        */
+        struct Entry {
+            Span span;
+            uint32_t thread;
+        };
+
+        Tracer() = default;
+
+        /**
+        * @brief Small stable number of the calling thread, used as the trace tid
+        */
+        static uint32_t threadIndex();
+
+        std::atomic<bool> enabled_{false};  ///< Callers take timestamps only when set
+        mutable std::mutex mutex_;          ///< Guards the members below
+        std::vector<Entry> spans_;          ///< Recorded spans, in completion order
+        uint64_t dropped_ = 0;              ///< Spans not kept because kMaxSpans was reached
+    };
+
+} // namespace tempdb
@@ -0,0 +1,100 @@
+#include "TrafficLog.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+
+namespace tempdb {
+
+    namespace {
+
+        const char kMagic[8] = {'T', 'D', 'B', 'T', 'R', 'C', '0', '1'};
+
+        void writeVarint(std::ofstream& out, uint64_t value) {
+            char bytes[10];
+            size_t n = 0;
+            do {
+                uint8_t byte = value & 0x7f;
+                value >>= 7;
+                if (value != 0) {
+                    byte |= 0x80;
+                }
+                bytes[n++] = static_cast<char>(byte);
+            } while (value != 0);
+            out.write(bytes, n);
+        }
+
+        bool readVarint(const std::string& data, size_t& pos, uint64_t& value) {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (pos >= data.size()) {
+                    return false;
+                }
+                uint8_t byte = static_cast<uint8_t>(data[pos++]);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    } // namespace
+
+    TrafficLog::Writer::Writer(const std::string& path)
+        : out_(path, std::ios::binary | std::ios::trunc), started_(false) {
+
+        if (!out_) {
+            throw std::runtime_error("Error: Could not open traffic log for writing: " + path);
+        }
+        out_.write(kMagic, sizeof(kMagic));
+    }
+
+    void TrafficLog::Writer::append(const std::string& command) {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t delta = 0;
+        if (started_) {
+            delta = std::chrono::duration_cast<std::chrono::microseconds>(now - last_).count();
+        }
+        started_ = true;
+        last_ = now;
+
+        writeVarint(out_, delta);
+        writeVarint(out_, command.size());
+        out_.write(command.data(), command.size());
+
+        if (!out_) {
+            throw std::runtime_error("Error: Failed to write traffic log");
+        }
+    }
+
+    std::vector<TrafficLog::Entry> TrafficLog::load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Error: Could not open traffic log: " + path);
+        }
+
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (data.size() < sizeof(kMagic) || data.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("Error: Not a tempDB traffic log: " + path);
+        }
+
+        std::vector<Entry> entries;
+        std::chrono::microseconds offset(0);
+        size_t pos = sizeof(kMagic);
+
+        while (pos < data.size()) {
+            uint64_t delta, length;
+            if (!readVarint(data, pos, delta) || !readVarint(data, pos, length) || length > data.size() - pos) {
+                throw std::runtime_error("Error: Truncated traffic log: " + path);
+            }
+
+            offset += std::chrono::microseconds(delta);
+            entries.push_back(Entry{offset, data.substr(pos, length)});
+            pos += length;
+        }
+
+        return entries;
+    }
+
+} // namespace tempdb
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+
+namespace tempdb {
+
+    /**
+    * @brief Compact binary log of timestamped RESP commands
+    *
+    * The file starts with an 8 byte magic followed by one record per command:
+    * the time since the previous record in microseconds and the command length,
+    * both as LEB128 varints, then the raw RESP bytes of the command.
+    */
+    class TrafficLog {
+    public:
+        /**
+        * @brief A single recorded command
+        */
+        struct Entry {
+            std::chrono::microseconds offset;   ///< Time since the first record
+            std::string command;                ///< Raw RESP-encoded command
+        };
+
+        /**
+        * @brief Appends commands to a traffic log as they are issued
+        */
+        class Writer {
+        public:
+            /**
+            * @brief Constructor - creates (or truncates) the log file
+            * @param path Log file path
+            * @throws std::runtime_error if the file cannot be opened
+            */
+            explicit Writer(const std::string& path);
+
+            /**
+            * @brief Record a command, timestamped with the current time
+            * @param command Raw RESP-encoded command
+            * @throws std::runtime_error if the write fails
+            */
+            void append(const std::string& command);
+
+        private:
+            std::ofstream out_;                                 ///< Log file stream
+            bool started_;                                      ///< Whether a record was written
+            std::chrono::steady_clock::time_point last_;        ///< Timestamp of the previous record
+        };
+
+        /**
+        * @brief Load every record of a traffic log
+        * @param path Log file path
+        * @return Records in the order they were captured
+        * @throws std::runtime_error if the file is missing or malformed
+        */
+        static std::vector<Entry> load(const std::string& path);
+    };
+
+} // namespace tempdb
@@ -1,8 +1,48 @@
 #include <iostream>
 #include <cstdlib>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include "Cli.hpp"
 #include "Client.hpp"
+#include "FanOut.hpp"
+#include "LoadGenerator.hpp"
+#include "Metrics.hpp"
+#include "Replayer.hpp"
+#include "Tracer.hpp"
+
+namespace {
+
+    /**
+    * @brief Writes the metrics and trace files when leaving main, whichever mode ran and however it ended
+    */
+    class ReportDump {
+    public:
+        ReportDump(const std::string& metricsPath, const std::string& tracePath)
+            : metricsPath_(metricsPath), tracePath_(tracePath) {}
+
+        ~ReportDump() {
+            try {
+                if (!metricsPath_.empty()) {
+                    tempdb::Metrics::instance().writeToFile(metricsPath_);
+                }
+                if (!tracePath_.empty()) {
+                    tempdb::Tracer::instance().writeToFile(tracePath_);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+
+    private:
+        std::string metricsPath_;
+        std::string tracePath_;
+    };
+
+} // namespace
 
 int main(int argc, char* argv[]) {
 
@@ -16,10 +56,112 @@ int main(int argc, char* argv[]) {
             return EXIT_FAILURE;
         }
 
-        std::cout << "Connecting to " << argParseResult.host << ":" << argParseResult.port << "..." << std::endl;
+        auto profile = tempdb::ConnectionProfile::fromName(argParseResult.profile);
+        tempdb::Network::setVerbose(argParseResult.verbose);
+        ReportDump reportDump(argParseResult.metricsPath, argParseResult.tracePath);
+        if (!argParseResult.tracePath.empty()) {
+            tempdb::Tracer::instance().enable();
+        }
+
+        // Run one command on every node of a fleet
+        if (!argParseResult.servers.empty()) {
+            tempdb::FanOut fanOut(argParseResult.servers, std::chrono::milliseconds(argParseResult.timeoutMillis),
+                                  profile);
+            return fanOut.run(argParseResult.execCommand);
+        }
+
+        // Replay a captured traffic log instead of starting a session
+        if (!argParseResult.replayPath.empty()) {
+            tempdb::Replayer replayer(argParseResult.host, argParseResult.port,
+                                      argParseResult.connections, argParseResult.replaySpeed, profile,
+                                      std::chrono::milliseconds(argParseResult.timeoutMillis));
+            return replayer.run(argParseResult.replayPath, argParseResult.histogramPath);
+        }
+
+        // Open-loop load test instead of a session
+        if (argParseResult.loadRate > 0) {
+            tempdb::LoadOptions options;
+            options.rate = argParseResult.loadRate;
+            options.durationSeconds = argParseResult.loadDuration;
+            options.poisson = argParseResult.poissonArrivals;
+            options.connections = argParseResult.connections;
+            options.command = argParseResult.loadCommand;
+            options.timeoutMillis = argParseResult.timeoutMillis;
+            options.metricsPath = argParseResult.metricsPath;
+
+            tempdb::LoadGenerator generator(argParseResult.host, argParseResult.port, options, profile);
+            return generator.run(argParseResult.histogramPath);
+        }
+
+        if (argParseResult.verbose) {
+            std::cout << "Connecting to " << argParseResult.host << ":" << argParseResult.port << "..." << std::endl;
+        }
+
+        tempdb::Deadline connectDeadline = tempdb::kNoDeadline;
+        if (argParseResult.timeoutMillis > 0) {
+            connectDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(argParseResult.timeoutMillis);
+        }
+
+        // Primary and replica are connected and verified in parallel; the replica only
+        // speeds reads up, so the session goes ahead without it if it is unreachable
+        auto connectStart = std::chrono::steady_clock::now();
+        std::future<std::vector<std::unique_ptr<tempdb::Network>>> replicaConnect;
+        if (!argParseResult.replicaHost.empty()) {
+            replicaConnect = std::async(std::launch::async, [&argParseResult, &profile, connectDeadline]() {
+                return tempdb::Network::connectAll({{argParseResult.replicaHost, argParseResult.replicaPort}},
+                                                   profile, connectDeadline);
+            });
+        }
+        auto networks = tempdb::Network::connectAll({{argParseResult.host, argParseResult.port}}, profile,
+                                                    connectDeadline);
+        std::unique_ptr<tempdb::Network> replica;
+        if (replicaConnect.valid()) {
+            try {
+                replica = std::move(replicaConnect.get()[0]);
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: Replica " << argParseResult.replicaHost << ":" << argParseResult.replicaPort
+                          << " unavailable, running without hedging: " << e.what() << std::endl;
+            }
+        }
+        if (argParseResult.verbose) {
+            std::cout << "Connected and verified " << (replica ? 2 : 1) << " connection(s) in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - connectStart).count()
+                      << " ms" << std::endl;
+        }
 
         // Create and run the client
-        auto client = std::make_unique<tempdb::Client>(argParseResult.host, argParseResult.port);
+        auto client = std::make_unique<tempdb::Client>(std::move(networks[0]), argParseResult.host,
+                                                       argParseResult.port, argParseResult.recordPath);
+        if (argParseResult.verbose && !argParseResult.recordPath.empty()) {
+            std::cout << "Recording commands to " << argParseResult.recordPath << std::endl;
+        }
+
+        if (argParseResult.compressThreshold > 0) {
+            tempdb::CodecOptions codecOptions;
+            codecOptions.threshold = argParseResult.compressThreshold;
+            if (!argParseResult.compressDictionary.empty()) {
+                codecOptions.dictionary = tempdb::Codec::loadDictionary(argParseResult.compressDictionary);
+            }
+            client->enableCompression(codecOptions);
+        }
+
+        if (replica) {
+            client->enableHedging(std::move(replica), argParseResult.hedgePercentile);
+            if (argParseResult.verbose) {
+                std::cout << "Hedging reads to " << argParseResult.replicaHost << ":" << argParseResult.replicaPort
+                          << " after p" << argParseResult.hedgePercentile << " latency" << std::endl;
+            }
+        }
+
+        client->setTimeout(std::chrono::milliseconds(argParseResult.timeoutMillis));
+
+        if (!argParseResult.prefetchPath.empty()) {
+            auto keys = tempdb::Client::loadKeys(argParseResult.prefetchPath);
+            size_t cached = client->prefetch(keys);
+            if (argParseResult.verbose) {
+                std::cout << "Prefetched " << cached << "/" << keys.size() << " keys" << std::endl;
+            }
+        }
 
         int exitCode = client->run();
 
@@ -0,0 +1,155 @@
+#include "Check.hpp"
+#include "Client.hpp"
+#include "TestServer.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+
+using namespace tempdb;
+
+/**
+ * Counts heap allocations made by the thread running the client while a
+ * measurement is active; the test server's threads are never counted
+ */
+namespace {
+
+    thread_local bool counting = false;
+    thread_local size_t allocations = 0;
+
+    void* allocate(size_t size) {
+        if (counting) {
+            ++allocations;
+        }
+        if (void* p = std::malloc(size == 0 ? 1 : size)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+
+} // namespace
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+    /**
+    * Serves the warm-up commands, then the measured ones with counting on, then
+    * end of input. Switching happens in underflow(), i.e. only once the client
+    * has finished the last warm-up command and asks for the next line.
+    */
+    class PhasedInput : public std::streambuf {
+    public:
+        PhasedInput(std::string warmUp, std::string measured)
+            : warmUp_(std::move(warmUp)), measured_(std::move(measured)) {
+            setg(warmUp_.data(), warmUp_.data(), warmUp_.data() + warmUp_.size());
+        }
+
+    protected:
+        int_type underflow() override {
+            if (!measuring_) {
+                measuring_ = true;
+                counting = true;
+                setg(measured_.data(), measured_.data(), measured_.data() + measured_.size());
+                return traits_type::to_int_type(*gptr());
+            }
+            counting = false;
+            return traits_type::eof();
+        }
+
+    private:
+        std::string warmUp_;
+        std::string measured_;
+        bool measuring_ = false;
+    };
+
+    /**
+    * Swallows the session's output without buffering it on the heap
+    */
+    class NullOutput : public std::streambuf {
+    protected:
+        int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    std::string repeat(const std::string& commands, int times) {
+        std::string out;
+        for (int i = 0; i < times; ++i) {
+            out += commands;
+        }
+        return out;
+    }
+
+    /**
+    * Run a session over the given commands and return the allocations made
+    * while serving the measured repetitions
+    */
+    size_t measureSession(Client& client, const std::string& commands) {
+        PhasedInput input(repeat(commands, 50), repeat(commands, 500));
+        NullOutput output;
+
+        std::streambuf* oldIn = std::cin.rdbuf(&input);
+        std::streambuf* oldOut = std::cout.rdbuf(&output);
+        allocations = 0;
+        client.run();
+        counting = false;
+        std::cin.rdbuf(oldIn);
+        std::cout.rdbuf(oldOut);
+        std::cin.clear();
+        std::cout.clear();
+        return allocations;
+    }
+
+    // Short and long (pooled) strings, integers, nil and an array
+    const std::string kCommands =
+        "SET alloc:short abc\n"
+        "SET alloc:long " + std::string(200, 'v') + "\n"
+        "GET alloc:short\n"
+        "GET alloc:long\n"
+        "GET alloc:missing\n"
+        "INCR alloc:counter\n"
+        "MGET alloc:short alloc:long alloc:missing\n"
+        "PING\n";
+
+    void testSessionDoesNotAllocate() {
+        test::TestServer server;
+        // Latency histograms grow on demand: a slow first reply per command sizes them up front
+        server.delayFirstReplies(std::chrono::milliseconds(50));
+
+        Client client("127.0.0.1", server.port());
+        size_t count = measureSession(client, kCommands);
+        if (count != 0) {
+            std::cerr << "Plain session: " << count << " allocation(s) over 4000 commands" << std::endl;
+        }
+        CHECK(count == 0);
+    }
+
+    void testHedgedSessionDoesNotAllocate() {
+        test::TestServer primary;
+        test::TestServer replica;
+        primary.delayFirstReplies(std::chrono::milliseconds(50));
+        replica.delayFirstReplies(std::chrono::milliseconds(50));
+
+        Client client("127.0.0.1", primary.port());
+        client.enableHedging(std::make_unique<Network>("127.0.0.1", replica.port()), 95);
+        size_t count = measureSession(client, kCommands);
+        if (count != 0) {
+            std::cerr << "Hedged session: " << count << " allocation(s) over 4000 commands" << std::endl;
+        }
+        CHECK(count == 0);
+    }
+
+} // namespace
+
+int main() {
+    testSessionDoesNotAllocate();
+    testHedgedSessionDoesNotAllocate();
+    return tempdb::test::testResult("AllocationTest");
+}
@@ -0,0 +1,173 @@
+#include "Batcher.hpp"
+#include "Check.hpp"
+#include "TestServer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tempdb;
+using ResponseType = RespProtocol::ResponseType;
+
+namespace {
+
+    const int kThreads = 16;
+    const int kRequestsPerThread = 500;
+
+    std::string encode(const std::vector<std::string>& tokens) {
+        return RespProtocol::encodeArray(tokens);
+    }
+
+    /**
+    * Every submitter must get the reply to its own request, with several of
+    * its requests in flight at a time
+    */
+    void testRepliesReachTheirSubmitters(test::TestServer& server) {
+        Network network("127.0.0.1", server.port());
+        Batcher batcher(network);
+
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < kRequestsPerThread; i += 10) {
+                    std::vector<std::shared_ptr<Batcher::Completion>> completions;
+                    for (int j = i; j < i + 10; ++j) {
+                        completions.push_back(batcher.submit(encode({"ECHO", std::to_string(t) + ":" + std::to_string(j)})));
+                    }
+                    for (int j = i; j < i + 10; ++j) {
+                        auto reply = completions[j - i]->wait();
+                        if (reply.text() != std::to_string(t) + ":" + std::to_string(j)) {
+                            ++mismatches;
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(mismatches == 0);
+    }
+
+    /**
+    * INCR from many threads: every value is handed out once, and each thread
+    * sees its own values rise, since its requests reach the server in order
+    */
+    void testIncrementsStayOrdered(test::TestServer& server) {
+        Network network("127.0.0.1", server.port());
+        Batcher batcher(network);
+
+        std::vector<std::vector<int64_t>> values(kThreads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t] {
+                std::vector<std::shared_ptr<Batcher::Completion>> completions;
+                for (int i = 0; i < kRequestsPerThread; ++i) {
+                    completions.push_back(batcher.submit(encode({"INCR", "batcher:counter"})));
+                }
+                for (auto& completion : completions) {
+                    auto reply = completion->wait();
+                    values[t].push_back(reply.type() == ResponseType::INTEGER ? reply.integerValue() : -1);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::set<int64_t> all;
+        bool ordered = true;
+        for (const auto& own : values) {
+            ordered = ordered && std::is_sorted(own.begin(), own.end()) &&
+                      std::adjacent_find(own.begin(), own.end()) == own.end();
+            all.insert(own.begin(), own.end());
+        }
+        CHECK(ordered);
+        CHECK(all.size() == static_cast<size_t>(kThreads * kRequestsPerThread));
+        CHECK(*all.begin() == 1);
+        CHECK(*all.rbegin() == kThreads * kRequestsPerThread);
+    }
+
+    /**
+    * Many producers on a ring far smaller than the load, behind a pinned depth
+    * of two: submitters keep finding the ring full and wrapping around it
+    */
+    void testSmallRingUnderContention(test::TestServer& server) {
+        Network network("127.0.0.1", server.port());
+        BatchOptions options;
+        options.queueCapacity = 8;
+        options.pipeline.minDepth = 2;
+        options.pipeline.maxDepth = 2;
+        options.pipeline.initialDepth = 2;
+        Batcher batcher(network, options);
+
+        const int producers = 32;
+        const int perProducer = 200;
+        std::atomic<int> pongs{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < producers; ++t) {
+            threads.emplace_back([&] {
+                std::vector<std::shared_ptr<Batcher::Completion>> completions;
+                for (int i = 0; i < perProducer; ++i) {
+                    completions.push_back(batcher.submit(encode({"PING"})));
+                }
+                for (auto& completion : completions) {
+                    if (completion->wait().text() == "PONG") {
+                        ++pongs;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(pongs == producers * perProducer);
+    }
+
+    /**
+    * A request that misses its deadline must not shift later replies
+    */
+    void testTimeoutKeepsRepliesMatched(test::TestServer& server) {
+        Network network("127.0.0.1", server.port());
+        Batcher batcher(network);
+
+        auto slow = batcher.submit(encode({"SLEEP", "100"}), std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+        auto next = batcher.submit(encode({"ECHO", "after"}));
+        CHECK_THROWS(slow->wait());
+        CHECK(next->wait().text() == "after");
+
+        // Expired before the I/O thread got to it: never sent, still no shift
+        auto expired = batcher.submit(encode({"ECHO", "never"}), std::chrono::steady_clock::now());
+        auto last = batcher.submit(encode({"ECHO", "last"}));
+        CHECK_THROWS(expired->wait());
+        CHECK(last->wait().text() == "last");
+    }
+
+    /**
+    * A lost connection fails what is in flight and everything submitted later
+    */
+    void testConnectionLossFailsRequests(test::TestServer& server) {
+        Network network("127.0.0.1", server.port());
+        Batcher batcher(network);
+
+        CHECK(batcher.submit(encode({"PING"}))->wait().text() == "PONG");
+        auto dropped = batcher.submit(encode({"CLOSE"}));
+        CHECK_THROWS(dropped->wait());
+        CHECK_THROWS(batcher.submit(encode({"PING"}))->wait());
+    }
+
+} // namespace
+
+int main() {
+    test::TestServer server;
+    testRepliesReachTheirSubmitters(server);
+    testIncrementsStayOrdered(server);
+    testSmallRingUnderContention(server);
+    testTimeoutKeepsRepliesMatched(server);
+    testConnectionLossFailsRequests(server);
+    return tempdb::test::testResult("BatcherTest");
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <iostream>
+
+/**
+ * @brief Minimal assertions for the test programs
+ *
+ * Each test is a plain executable run by `make test`: CHECK reports a failed
+ * condition and keeps going, and main() returns testResult() so any failure
+ * fails the target.
+ */
+namespace tempdb::test {
+
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline int testResult(const char* name) {
+        if (failures() == 0) {
+            std::cout << name << ": passed" << std::endl;
+            return 0;
+        }
+        std::cout << name << ": " << failures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+} // namespace tempdb::test
+
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: "          \
+                      << #condition << std::endl;                                   \
+            ++tempdb::test::failures();                                             \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_THROWS(expression)                                                    \
+    do {                                                                            \
+        bool thrown = false;                                                        \
+        try {                                                                       \
+            (void)(expression);                                                     \
+        } catch (const std::exception&) {                                           \
+            thrown = true;                                                          \
+        }                                                                           \
+        if (!thrown) {                                                              \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": expected an exception: " \
+                      << #expression << std::endl;                                  \
+            ++tempdb::test::failures();                                             \
+        }                                                                           \
+    } while (0)
@@ -0,0 +1,67 @@
+#include "Check.hpp"
+#include "Codec.hpp"
+#include "Lz4.hpp"
+
+#include <cstdint>
+#include <string>
+
+using namespace tempdb;
+
+namespace {
+
+    void testRoundTrip() {
+        std::string input;
+        for (int i = 0; i < 200; ++i) {
+            input += "{\"id\":" + std::to_string(i) + ",\"name\":\"user\",\"active\":true}";
+        }
+        std::string block = Lz4::compress(input);
+        CHECK(block.size() < input.size());
+        CHECK(Lz4::decompress(block, input.size()) == input);
+
+        std::string dictionary = "{\"id\":0,\"name\":\"user\",\"active\":true}";
+        std::string small = "{\"id\":7,\"name\":\"user\",\"active\":false}";
+        std::string withDictionary = Lz4::compress(small, dictionary);
+        CHECK(Lz4::decompress(withDictionary, small.size(), dictionary) == small);
+
+        // A run of one byte is the best case for expansion
+        std::string run(100000, 'a');
+        CHECK(Lz4::decompress(Lz4::compress(run), run.size()) == run);
+    }
+
+    void testRejectsImplausibleOriginalSize() {
+        std::string block = Lz4::compress("hello hello hello hello hello");
+
+        CHECK_THROWS(Lz4::decompress(block, 0xffffffffu));
+        CHECK_THROWS(Lz4::decompress(block, block.size() * 255 + 1));
+        CHECK_THROWS(Lz4::decompress("", 1));
+    }
+
+    void testCodecIgnoresCorruptHeader() {
+        CodecOptions options;
+        options.threshold = 16;
+        Codec codec(options);
+
+        std::string value(4096, 'x');
+        std::string compressed = codec.compress(value);
+        CHECK(compressed != value);
+
+        std::string out;
+        CHECK(codec.decompress(compressed, out));
+        CHECK(out == value);
+
+        // Claim a 4 GB original size in the header
+        std::string forged = compressed;
+        for (size_t i = 8; i < 12; ++i) {
+            forged[i] = static_cast<char>(0xff);
+        }
+        CHECK(!codec.decompress(forged, out));
+    }
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testRejectsImplausibleOriginalSize();
+    testCodecIgnoresCorruptHeader();
+    return tempdb::test::testResult("Lz4Test");
+}
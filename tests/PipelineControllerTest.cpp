@@ -0,0 +1,150 @@
+#include "Check.hpp"
+#include "PipelineController.hpp"
+
+#include <vector>
+
+using namespace tempdb;
+using Clock = PipelineController::Clock;
+using std::chrono::microseconds;
+
+namespace {
+
+    const microseconds kBaseRtt(100);
+
+    /**
+    * Feeds a controller synthetic replies on a synthetic clock
+    */
+    class Link {
+    public:
+        explicit Link(PipelineController& controller) : controller_(controller) {
+            // The first reply only opens the first round
+            controller_.onReply(kBaseRtt, now_);
+        }
+
+        /**
+        * One round: as many replies as the current depth, spread over roundTime
+        * @param saturated Whether the sender reached the depth during the round
+        */
+        void round(Clock::duration rtt, Clock::duration roundTime, bool saturated = true) {
+            size_t depth = controller_.depth();
+            if (saturated) {
+                controller_.onSend(depth);
+            }
+            for (size_t i = 0; i < depth; ++i) {
+                now_ += roundTime / depth;
+                controller_.onReply(rtt, now_);
+            }
+        }
+
+    private:
+        PipelineController& controller_;
+        Clock::time_point now_ = Clock::time_point() + std::chrono::seconds(1);
+    };
+
+    PipelineOptions options(size_t initialDepth) {
+        PipelineOptions result;
+        result.initialDepth = initialDepth;
+        result.targetDelay = microseconds(1000);
+        return result;
+    }
+
+    void testSlowStartDoublesWhileThroughputGrows() {
+        PipelineController controller(options(8));
+        Link link(controller);
+
+        // Every round takes one RTT whatever the depth: throughput doubles with it
+        std::vector<size_t> depths;
+        for (int i = 0; i < 3; ++i) {
+            link.round(kBaseRtt, kBaseRtt);
+            depths.push_back(controller.depth());
+        }
+        CHECK((depths == std::vector<size_t>{16, 32, 64}));
+    }
+
+    void testSlowStartEndsWhenThroughputStalls() {
+        PipelineController controller(options(8));
+        Link link(controller);
+
+        // Round time grows with the depth: a fixed server rate, more depth buys nothing
+        link.round(kBaseRtt, microseconds(10) * controller.depth());
+        CHECK(controller.depth() == 16);
+        link.round(kBaseRtt, microseconds(10) * controller.depth());
+        CHECK(controller.depth() == 17);
+        link.round(kBaseRtt, microseconds(10) * controller.depth());
+        CHECK(controller.depth() == 18);
+    }
+
+    void testQueueingDelayDecreases() {
+        PipelineController controller(options(8));
+        Link link(controller);
+        auto queued = kBaseRtt + microseconds(2000);
+
+        std::vector<size_t> depths;
+        for (int i = 0; i < 6; ++i) {
+            link.round(queued, queued);
+            depths.push_back(controller.depth());
+        }
+        // Three quarters each round, at least one less, never below minDepth
+        CHECK((depths == std::vector<size_t>{6, 4, 3, 2, 1, 1}));
+    }
+
+    void testSmallDepthsStillDecrease() {
+        for (size_t initial : {2, 3}) {
+            PipelineController controller(options(initial));
+            Link link(controller);
+            link.round(kBaseRtt + microseconds(2000), kBaseRtt);
+            CHECK(controller.depth() == initial - 1);
+        }
+    }
+
+    void testHolds() {
+        // Delay between half the target and the target: neither grow nor shrink
+        PipelineController controller(options(8));
+        Link link(controller);
+        for (int i = 0; i < 5; ++i) {
+            link.round(kBaseRtt + microseconds(700), kBaseRtt);
+        }
+        CHECK(controller.depth() == 8);
+
+        // No queueing, but the sender never reached the depth: no reason to grow
+        PipelineController idle(options(8));
+        Link idleLink(idle);
+        for (int i = 0; i < 5; ++i) {
+            idleLink.round(kBaseRtt, kBaseRtt, false);
+        }
+        CHECK(idle.depth() == 8);
+    }
+
+    void testLimits() {
+        PipelineOptions pinned = options(8);
+        pinned.minDepth = 4;
+        pinned.maxDepth = 4;
+        PipelineController controller(pinned);
+        CHECK(controller.depth() == 4);
+        Link link(controller);
+        link.round(kBaseRtt, kBaseRtt);
+        CHECK(controller.depth() == 4);
+        link.round(kBaseRtt + microseconds(5000), kBaseRtt);
+        CHECK(controller.depth() == 4);
+
+        PipelineOptions inverted = options(8);
+        inverted.minDepth = 16;
+        inverted.maxDepth = 2;
+        CHECK_THROWS(PipelineController{inverted});
+
+        PipelineOptions zero = options(8);
+        zero.minDepth = 0;
+        CHECK_THROWS(PipelineController{zero});
+    }
+
+} // namespace
+
+int main() {
+    testSlowStartDoublesWhileThroughputGrows();
+    testSlowStartEndsWhenThroughputStalls();
+    testQueueingDelayDecreases();
+    testSmallDepthsStillDecrease();
+    testHolds();
+    testLimits();
+    return tempdb::test::testResult("PipelineControllerTest");
+}
@@ -0,0 +1,92 @@
+#include "Check.hpp"
+#include "RespProtocol.hpp"
+
+#include <string>
+
+using namespace tempdb;
+using ResponseType = RespProtocol::ResponseType;
+
+namespace {
+
+    void testParsesWellFormedReplies() {
+        auto bulk = RespProtocol::parseResponse("$5\r\nhello\r\n");
+        CHECK(bulk.type() == ResponseType::BULK_STRING);
+        CHECK(bulk.text() == "hello");
+
+        auto nil = RespProtocol::parseResponse("$-1\r\n");
+        CHECK(nil.isNil());
+
+        auto array = RespProtocol::parseResponse("*3\r\n:1\r\n+OK\r\n$0\r\n\r\n");
+        CHECK(array.type() == ResponseType::ARRAY);
+        CHECK(array.elements().size() == 3);
+        CHECK(array.elements()[0].integerValue() == 1);
+        CHECK(array.elements()[1].text() == "OK");
+        CHECK(array.elements()[2].text().empty());
+
+        CHECK(RespProtocol::replyLength("$5\r\nhello\r\n") == 11);
+        CHECK(RespProtocol::replyLength("$5\r\nhel") == 0);
+        CHECK(RespProtocol::replyLength("*2\r\n:1\r\n") == 0);
+    }
+
+    void testRejectsMalformedLengths() {
+        CHECK_THROWS(RespProtocol::parseResponse("$abc\r\n"));
+        CHECK_THROWS(RespProtocol::parseResponse("$5x\r\nhello\r\n"));
+        CHECK_THROWS(RespProtocol::parseResponse("$\r\n\r\n"));
+        CHECK_THROWS(RespProtocol::parseResponse("*abc\r\n"));
+        CHECK_THROWS(RespProtocol::parseResponse("*2 \r\n:1\r\n:2\r\n"));
+        CHECK_THROWS(RespProtocol::parseResponse("$99999999999999999999\r\n"));
+
+        // Framing must fail too, not wait for bytes that will never make sense
+        CHECK_THROWS(RespProtocol::replyLength("$abc\r\n"));
+        CHECK_THROWS(RespProtocol::replyLength("*x\r\n"));
+    }
+
+    void testDoesNotTrustLengthsOnTheWire() {
+        // A bulk string longer than the data must not read past it
+        CHECK_THROWS(RespProtocol::parseResponse("$9223372036854775807\r\nabc\r\n"));
+
+        // A huge element count must fail on the missing elements rather than
+        // reserving room for them up front
+        CHECK_THROWS(RespProtocol::parseResponse("*9223372036854775807\r\n:1\r\n"));
+        CHECK(RespProtocol::replyLength("*9223372036854775807\r\n:1\r\n") == 0);
+    }
+
+    void testFramesRepliesFedInPieces() {
+        // Every split point, including inside a \r\n, must give the same answer
+        const std::string reply = "*3\r\n$5\r\nhello\r\n*2\r\n:1\r\n$-1\r\n+OK\r\n";
+        for (size_t split = 0; split < reply.size(); ++split) {
+            std::string buffer = "+prior\r\n";
+            const size_t start = buffer.size();
+            RespProtocol::ReplyFramer framer;
+            buffer.append(reply, 0, split);
+            CHECK(framer.measure(buffer, start) == 0);
+            buffer.append(reply, split);
+            buffer += ":2\r\n";
+            CHECK(framer.measure(buffer, start) == reply.size());
+        }
+
+        // Byte by byte, then the next reply after a reset
+        std::string buffer;
+        RespProtocol::ReplyFramer framer;
+        size_t length = 0;
+        for (char c : reply) {
+            CHECK(length == 0);
+            buffer += c;
+            length = framer.measure(buffer);
+        }
+        CHECK(length == reply.size());
+        buffer.erase(0, length);
+        framer.reset();
+        buffer += "$3\r\nabc\r\n";
+        CHECK(framer.measure(buffer) == 9);
+    }
+
+} // namespace
+
+int main() {
+    testParsesWellFormedReplies();
+    testRejectsMalformedLengths();
+    testDoesNotTrustLengthsOnTheWire();
+    testFramesRepliesFedInPieces();
+    return tempdb::test::testResult("RespProtocolTest");
+}
@@ -0,0 +1,185 @@
+#include "TestServer.hpp"
+#include "RespProtocol.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace tempdb::test {
+
+    namespace {
+
+        std::string bulk(const std::string& value) {
+            return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+        }
+
+    } // namespace
+
+    TestServer::TestServer() {
+        listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0) {
+            throw std::runtime_error("TestServer: could not create socket");
+        }
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listenFd_, 64) < 0 ||
+            getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+            close(listenFd_);
+            throw std::runtime_error("TestServer: could not listen");
+        }
+        port_ = ntohs(address.sin_port);
+
+        acceptor_ = std::thread(&TestServer::acceptLoop, this);
+    }
+
+    TestServer::~TestServer() {
+        stopping_ = true;
+        // Wakes accept() and every recv() with an error or end of stream
+        shutdown(listenFd_, SHUT_RDWR);
+        acceptor_.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : connections_) {
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+        close(listenFd_);
+    }
+
+    void TestServer::acceptLoop() {
+        while (!stopping_) {
+            int fd = accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                close(fd);
+                break;
+            }
+            connections_.push_back(fd);
+            threads_.emplace_back(&TestServer::serve, this, fd);
+        }
+    }
+
+    void TestServer::serve(int fd) {
+        std::string pending;
+        char buffer[16384];
+
+        bool open = true;
+        while (open) {
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                break;
+            }
+            pending.append(buffer, received);
+
+            // Answer every complete request, a pipelined burst gets its replies in one write
+            std::string replies;
+            size_t length;
+            while (open && (length = RespProtocol::replyLength(pending)) != 0) {
+                auto request = RespProtocol::parseResponse(pending.substr(0, length));
+                pending.erase(0, length);
+
+                std::vector<std::string> args;
+                for (const auto& element : request.elements()) {
+                    args.emplace_back(element.text());
+                }
+                bool closeConnection = false;
+                replies += handle(args, closeConnection);
+                open = !closeConnection;
+            }
+
+            size_t sent = 0;
+            while (sent < replies.size()) {
+                ssize_t n = send(fd, replies.data() + sent, replies.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    open = false;
+                    break;
+                }
+                sent += n;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.erase(std::find(connections_.begin(), connections_.end(), fd));
+        close(fd);
+    }
+
+    std::string TestServer::handle(const std::vector<std::string>& args, bool& closeConnection) {
+        if (args.empty()) {
+            return "-ERR empty command\r\n";
+        }
+        std::string name = args[0];
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::toupper(c); });
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (firstReplyDelay_.count() > 0 && seenCommands_.insert(name).second) {
+            lock.unlock();
+            std::this_thread::sleep_for(firstReplyDelay_);
+            lock.lock();
+        }
+
+        if (name == "PING") {
+            return args.size() > 1 ? bulk(args[1]) : "+PONG\r\n";
+        }
+        if (name == "ECHO" && args.size() == 2) {
+            return bulk(args[1]);
+        }
+        if (name == "SET" && args.size() == 3) {
+            store_[args[1]] = args[2];
+            return "+OK\r\n";
+        }
+        if (name == "GET" && args.size() == 2) {
+            auto it = store_.find(args[1]);
+            return it == store_.end() ? "$-1\r\n" : bulk(it->second);
+        }
+        if (name == "DEL") {
+            size_t removed = 0;
+            for (size_t i = 1; i < args.size(); ++i) {
+                removed += store_.erase(args[i]);
+            }
+            return ":" + std::to_string(removed) + "\r\n";
+        }
+        if (name == "INCR" && args.size() == 2) {
+            auto& value = store_[args[1]];
+            value = std::to_string((value.empty() ? 0 : std::stoll(value)) + 1);
+            return ":" + value + "\r\n";
+        }
+        if (name == "MGET") {
+            std::string reply = "*" + std::to_string(args.size() - 1) + "\r\n";
+            for (size_t i = 1; i < args.size(); ++i) {
+                auto it = store_.find(args[i]);
+                reply += it == store_.end() ? "$-1\r\n" : bulk(it->second);
+            }
+            return reply;
+        }
+        if (name == "SLEEP" && args.size() == 2) {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::stoll(args[1])));
+            return "+OK\r\n";
+        }
+        if (name == "CLOSE") {
+            closeConnection = true;
+            return "";
+        }
+        return "-ERR unknown command '" + args[0] + "'\r\n";
+    }
+
+} // namespace tempdb::test
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tempdb::test {
+
+    /**
+    * @brief In-process RESP server for the tests
+    *
+    * Listens on an ephemeral loopback port and serves each connection on its own
+    * thread, replying in order to pipelined requests. Supports PING, ECHO, SET,
+    * GET, DEL, INCR and MGET over one shared keyspace, plus two test commands:
+    * SLEEP <ms> delays its own reply and CLOSE drops the connection.
+    */
+    class TestServer {
+    public:
+        /**
+        * @brief Constructor - binds the port and starts accepting
+        * @throws std::runtime_error if the socket cannot be set up
+        */
+        TestServer();
+
+        /**
+        * @brief Destructor - closes every connection and joins their threads
+        */
+        ~TestServer();
+
+        TestServer(const TestServer&) = delete;
+        TestServer& operator=(const TestServer&) = delete;
+
+        int port() const { return port_; }
+
+        /**
+        * @brief Delay the first reply to each command name
+        *
+        * Lets a test size its latency histograms during warm-up, so later
+        * replies never need a new bucket.
+        */
+        void delayFirstReplies(std::chrono::milliseconds delay) { firstReplyDelay_ = delay; }
+
+    private:
+        void acceptLoop();
+        void serve(int fd);
+        std::string handle(const std::vector<std::string>& args, bool& closeConnection);
+
+        int listenFd_;
+        int port_;
+        std::atomic<bool> stopping_{false};
+        std::chrono::milliseconds firstReplyDelay_{0};
+
+        std::mutex mutex_;                                          ///< Guards the members below
+        std::unordered_map<std::string, std::string> store_;        ///< Keyspace shared by all connections
+        std::unordered_set<std::string> seenCommands_;              ///< Commands replied to at least once
+        std::vector<int> connections_;                              ///< Open connection descriptors
+        std::vector<std::thread> threads_;                          ///< One per accepted connection
+
+        std::thread acceptor_;
+    };
+
+} // namespace tempdb::test